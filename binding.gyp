@@ -35,8 +35,14 @@
         'deps/lswms',
        ],
       'sources': [
+        'src/deflate.cc',
         'src/image.cc',
+        'src/ingest.cc',
+        'src/pagecache.cc',
+        'src/pipeline.cc',
+        'src/pixpool.cc',
         'src/tesseract.cc',
+        'src/tesseractpool.cc',
         'src/util.cc',
         'src/zxing.cc',
         'src/module.cc',
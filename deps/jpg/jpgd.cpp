@@ -11,6 +11,8 @@
 
 #include "jpgd.h"
 #include <string.h>
+#include <math.h>
+#include <stdint.h>
 
 #include <assert.h>
 #define JPGD_ASSERT(x) assert(x)
@@ -332,6 +334,69 @@ void idct_4x4(const jpgd_block_t* pSrc_ptr, uint8* pDst_ptr)
   }
 }
 
+// Reduced IDCT: each output sample is the mean of the (8 / size)^2 pixels it
+// replaces, computed directly from the coefficients with box-averaged basis
+// functions. size 1 is the DC term alone.
+struct scaled_idct_tables
+{
+  int m_basis[3][4][8]; // [log2(size) - 1][output][frequency], 1.12 fixed point
+
+  scaled_idct_tables()
+  {
+    for (int shift = 1; shift <= 2; shift++)
+    {
+      int size = 1 << shift, span = 8 >> shift;
+      for (int k = 0; k < size; k++)
+        for (int u = 0; u < 8; u++)
+        {
+          double sum = 0;
+          for (int x = k * span; x < (k + 1) * span; x++)
+            sum += (u ? 0.5 : 0.5 / sqrt(2.0)) * cos((2 * x + 1) * u * 3.14159265358979323846 / 16);
+          m_basis[shift - 1][k][u] = static_cast<int>(floor(sum / span * 4096 + 0.5));
+        }
+    }
+  }
+};
+
+static void idct_scaled(const jpgd_block_t* pSrc_ptr, uint8* pDst_ptr, int size)
+{
+  if (size == 1)
+  {
+    int k = ((pSrc_ptr[0] + 4) >> 3) + 128;
+    pDst_ptr[0] = static_cast<uint8>(CLAMP(k));
+    return;
+  }
+
+  static const scaled_idct_tables s_tables;
+  const int (*basis)[8] = s_tables.m_basis[size == 2 ? 0 : 1];
+
+  // Rows first, keeping 12 fractional bits, then columns.
+  int64_t temp[8][4];
+  for (int v = 0; v < 8; v++)
+  {
+    const jpgd_block_t* pRow = pSrc_ptr + v * 8;
+    for (int k = 0; k < size; k++)
+    {
+      int64_t sum = 0;
+      for (int u = 0; u < 8; u++)
+        sum += static_cast<int64_t>(basis[k][u]) * pRow[u];
+      temp[v][k] = sum;
+    }
+  }
+
+  for (int j = 0; j < size; j++)
+  {
+    for (int k = 0; k < size; k++)
+    {
+      int64_t sum = 0;
+      for (int v = 0; v < 8; v++)
+        sum += basis[j][v] * temp[v][k];
+      int i = static_cast<int>((sum + (1 << 23)) >> 24) + 128;
+      pDst_ptr[j * 8 + k] = static_cast<uint8>(CLAMP(i));
+    }
+  }
+}
+
 // Retrieve one character from the input stream.
 inline uint jpeg_decoder::get_char()
 {
@@ -1358,6 +1423,8 @@ void jpeg_decoder::init(jpeg_decoder_stream *pStream)
   m_error_code = JPGD_SUCCESS;
   m_ready_flag = false;
   m_image_x_size = m_image_y_size = 0;
+  m_scale_shift = 0;
+  m_luma_only = false;
   m_pStream = pStream;
   m_progressive_flag = JPGD_FALSE;
 
@@ -1499,7 +1566,24 @@ void jpeg_decoder::transform_mcu(int mcu_row)
 
   for (int mcu_block = 0; mcu_block < m_blocks_per_mcu; mcu_block++)
   {
-    idct(pSrc_ptr, pDst_ptr, m_mcu_block_max_zag[mcu_block]);
+    if (!m_luma_only || m_mcu_org[mcu_block] == 0)
+      idct(pSrc_ptr, pDst_ptr, m_mcu_block_max_zag[mcu_block]);
+    pSrc_ptr += 64;
+    pDst_ptr += 64;
+  }
+}
+
+// Like transform_mcu(), but stores only the top-left (8 >> m_scale_shift)^2 samples of each block.
+void jpeg_decoder::transform_mcu_scaled(int mcu_row)
+{
+  jpgd_block_t* pSrc_ptr = m_pMCU_coefficients;
+  uint8* pDst_ptr = m_pSample_buf + mcu_row * m_blocks_per_mcu * 64;
+  const int size = 8 >> m_scale_shift;
+
+  for (int mcu_block = 0; mcu_block < m_blocks_per_mcu; mcu_block++)
+  {
+    if (!m_luma_only || m_mcu_org[mcu_block] == 0)
+      idct_scaled(pSrc_ptr, pDst_ptr, size);
     pSrc_ptr += 64;
     pDst_ptr += 64;
   }
@@ -1689,7 +1773,9 @@ void jpeg_decoder::load_next_row()
       }
     }
 
-    if (m_freq_domain_chroma_upsample)
+    if (m_scale_shift)
+      transform_mcu_scaled(mcu_row);
+    else if (m_freq_domain_chroma_upsample)
       transform_mcu_expand(mcu_row);
     else
       transform_mcu(mcu_row);
@@ -1855,7 +1941,9 @@ void jpeg_decoder::decode_next_row()
       row_block++;
     }
 
-    if (m_freq_domain_chroma_upsample)
+    if (m_scale_shift)
+      transform_mcu_scaled(mcu_row);
+    else if (m_freq_domain_chroma_upsample)
       transform_mcu_expand(mcu_row);
     else
       transform_mcu(mcu_row);
@@ -2101,6 +2189,61 @@ void jpeg_decoder::expanded_convert()
   }
 }
 
+// Converts one reduced scan line. Chroma is replicated from the nearest sample.
+void jpeg_decoder::scaled_convert()
+{
+  const int size = 8 >> m_scale_shift;
+  const int row = (m_max_mcu_y_size >> m_scale_shift) - m_mcu_lines_left;
+  const int h_samp = m_comp_h_samp[0], v_samp = m_comp_v_samp[0];
+  const int mcu_width = m_max_mcu_x_size >> m_scale_shift;
+  const uint8* pY_row = m_pSample_buf + (row / size) * h_samp * 64 + (row % size) * 8;
+  const uint8* pC_row = m_pSample_buf + h_samp * v_samp * 64 + (row / v_samp) * 8;
+  uint8* d = m_pScan_line_0;
+
+  for (int i = 0; i < m_max_mcus_per_row; i++)
+  {
+    const uint8* pMCU_y = pY_row + i * m_blocks_per_mcu * 64;
+    const uint8* pMCU_c = pC_row + i * m_blocks_per_mcu * 64;
+    for (int x = 0; x < mcu_width; x++)
+    {
+      int y = pMCU_y[(x / size) * 64 + (x % size)];
+      if (m_dest_bytes_per_pixel == 1)
+      {
+        *d++ = static_cast<uint8>(y);
+        continue;
+      }
+      int cb = pMCU_c[x / h_samp];
+      int cr = pMCU_c[64 + x / h_samp];
+
+      d[0] = clamp(y + m_crr[cr]);
+      d[1] = clamp(y + ((m_crg[cr] + m_cbg[cb]) >> 16));
+      d[2] = clamp(y + m_cbb[cb]);
+      d[3] = 255;
+
+      d += 4;
+    }
+  }
+}
+
+// Copies one row of the luma blocks.
+void jpeg_decoder::luma_convert()
+{
+  int row = m_max_mcu_y_size - m_mcu_lines_left;
+  const int h_samp = m_comp_h_samp[0];
+  const uint8* s = m_pSample_buf + (row >> 3) * h_samp * 64 + (row & 7) * 8;
+  uint8* d = m_pScan_line_0;
+
+  for (int i = m_max_mcus_per_row; i > 0; i--)
+  {
+    for (int k = 0; k < h_samp; k++)
+    {
+      memcpy(d, s + k * 64, 8);
+      d += 8;
+    }
+    s += m_blocks_per_mcu * 64;
+  }
+}
+
 // Find end of image (EOI) marker, so we can return to the user the exact size of the input stream.
 void jpeg_decoder::find_eoi()
 {
@@ -2140,13 +2283,23 @@ int jpeg_decoder::decode(const void** pScan_line, uint* pScan_line_len)
       decode_next_row();
 
     // Find the EOI marker if that was the last row.
-    if (m_total_lines_left <= m_max_mcu_y_size)
+    if (m_total_lines_left <= (m_max_mcu_y_size >> m_scale_shift))
       find_eoi();
 
-    m_mcu_lines_left = m_max_mcu_y_size;
+    m_mcu_lines_left = m_max_mcu_y_size >> m_scale_shift;
   }
 
-  if (m_freq_domain_chroma_upsample)
+  if (m_scale_shift)
+  {
+    scaled_convert();
+    *pScan_line = m_pScan_line_0;
+  }
+  else if (m_luma_only)
+  {
+    luma_convert();
+    *pScan_line = m_pScan_line_0;
+  }
+  else if (m_freq_domain_chroma_upsample)
   {
     expanded_convert();
     *pScan_line = m_pScan_line_0;
@@ -2524,14 +2677,14 @@ void jpeg_decoder::init_frame()
   m_max_mcus_per_col = (m_image_y_size + (m_max_mcu_y_size - 1)) / m_max_mcu_y_size;
 
   // These values are for the *destination* pixels: after conversion.
-  if (m_scan_type == JPGD_GRAYSCALE)
+  if ((m_scan_type == JPGD_GRAYSCALE) || (m_luma_only))
     m_dest_bytes_per_pixel = 1;
   else
     m_dest_bytes_per_pixel = 4;
 
   m_dest_bytes_per_scan_line = ((m_image_x_size + 15) & 0xFFF0) * m_dest_bytes_per_pixel;
 
-  m_real_dest_bytes_per_scan_line = (m_image_x_size * m_dest_bytes_per_pixel);
+  m_real_dest_bytes_per_scan_line = (get_scaled_width() * m_dest_bytes_per_pixel);
 
   // Initialize two scan line buffers.
   m_pScan_line_0 = (uint8 *)alloc(m_dest_bytes_per_scan_line, true);
@@ -2556,7 +2709,7 @@ void jpeg_decoder::init_frame()
 	// Freq. domain chroma upsampling is only supported for H2V2 subsampling factor (the most common one I've seen).
   m_freq_domain_chroma_upsample = false;
 #if JPGD_SUPPORT_FREQ_DOMAIN_UPSAMPLING
-  m_freq_domain_chroma_upsample = (m_expanded_blocks_per_mcu == 4*3);
+  m_freq_domain_chroma_upsample = (m_expanded_blocks_per_mcu == 4*3) && !m_scale_shift && !m_luma_only;
 #endif
 
   if (m_freq_domain_chroma_upsample)
@@ -2564,7 +2717,7 @@ void jpeg_decoder::init_frame()
   else
     m_pSample_buf = (uint8 *)alloc(m_max_blocks_per_row * 64);
 
-  m_total_lines_left = m_image_y_size;
+  m_total_lines_left = get_scaled_height();
 
   m_mcu_lines_left = 0;
 
@@ -2934,6 +3087,18 @@ jpeg_decoder::jpeg_decoder(jpeg_decoder_stream *pStream)
   decode_init(pStream);
 }
 
+void jpeg_decoder::set_scale(int shift)
+{
+  if (!m_ready_flag)
+    m_scale_shift = JPGD_MAX(0, JPGD_MIN(3, shift));
+}
+
+void jpeg_decoder::set_luma_only(bool luma_only)
+{
+  if (!m_ready_flag)
+    m_luma_only = luma_only;
+}
+
 int jpeg_decoder::begin_decoding()
 {
   if (m_ready_flag)
@@ -128,6 +128,15 @@ namespace jpgd
     // If JPGD_SUCCESS is returned you may then call decode() on each scanline.
     int begin_decoding();
 
+    // Decodes at 1/(1 << shift) of the full size (shift 0-3) from reduced IDCTs, skipping
+    // the full resolution reconstruction. Call before begin_decoding(). decode() then returns
+    // get_scaled_height() scan lines of get_scaled_width() pixels.
+    void set_scale(int shift);
+
+    // Returns only the luma plane as 8-bit grayscale scan lines, skipping the chroma IDCTs, upsampling
+    // and color conversion. Call before begin_decoding().
+    void set_luma_only(bool luma_only);
+
     // Returns the next scan line.
     // For grayscale images, pScan_line will point to a buffer containing 8-bit pixels (get_bytes_per_pixel() will return 1). 
     // Otherwise, it will always point to a buffer containing 32-bit RGBA pixels (A will always be 255, and get_bytes_per_pixel() will return 4).
@@ -140,6 +149,8 @@ namespace jpgd
 
     inline int get_width() const { return m_image_x_size; }
     inline int get_height() const { return m_image_y_size; }
+    inline int get_scaled_width() const { return (m_image_x_size + (1 << m_scale_shift) - 1) >> m_scale_shift; }
+    inline int get_scaled_height() const { return (m_image_y_size + (1 << m_scale_shift) - 1) >> m_scale_shift; }
 
     inline int get_num_components() const { return m_comps_in_frame; }
 
@@ -240,6 +251,8 @@ namespace jpgd
     int m_expanded_blocks_per_row;
     int m_expanded_blocks_per_component;
     bool  m_freq_domain_chroma_upsample;
+    int m_scale_shift;
+    bool m_luma_only;
     int m_max_mcus_per_col;
     uint m_last_dc_val[JPGD_MAX_COMPONENTS];
     jpgd_block_t* m_pMCU_coefficients;
@@ -276,6 +289,7 @@ namespace jpgd
     void fix_in_buffer();
     void transform_mcu(int mcu_row);
     void transform_mcu_expand(int mcu_row);
+    void transform_mcu_scaled(int mcu_row);
     coeff_buf* coeff_buf_open(int block_num_x, int block_num_y, int block_len_x, int block_len_y);
     inline jpgd_block_t *coeff_buf_getp(coeff_buf *cb, int block_x, int block_y);
     void load_next_row();
@@ -298,6 +312,8 @@ namespace jpgd
     void H1V1Convert();
     void gray_convert();
     void expanded_convert();
+    void scaled_convert();
+    void luma_convert();
     void find_eoi();
     inline uint get_char();
     inline uint get_char(bool *pPadding_flag);
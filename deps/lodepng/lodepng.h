@@ -791,6 +791,16 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings);
 
+/*
+Compresses one band of a larger buffer with deflate. Unless final is set, the
+output ends with a sync flush instead of a final block, so it is byte aligned
+and the deflate data of the next band can be appended directly. Each band
+starts with an empty LZ77 window, so bands can be compressed in parallel.
+*/
+unsigned lodepng_deflate_band(unsigned char** out, size_t* outsize,
+                              const unsigned char* in, size_t insize, unsigned final,
+                              const LodePNGCompressSettings* settings);
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 #endif /*LODEPNG_COMPILE_ZLIB*/
 
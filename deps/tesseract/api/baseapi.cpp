@@ -59,6 +59,7 @@
 #include "paragraphs.h"
 #include "tessvars.h"
 #include "control.h"
+#include "classifier_cache.h"
 #include "dict.h"
 #include "pgedit.h"
 #include "paramsd.h"
@@ -2114,6 +2115,7 @@ void TessBaseAPI::End() {
 // of these caches.
 void TessBaseAPI::ClearPersistentCache() {
   Dict::GlobalDawgCache()->DeleteUnusedDawgs();
+  Classify::GlobalClassifierCache()->DeleteUnusedData();
 }
 
 /**
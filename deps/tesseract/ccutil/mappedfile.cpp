@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////
+// File:        mappedfile.cpp
+// Description: Read-only memory mapping of a whole data file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#include "mappedfile.h"
+
+#include "ccutil.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tesseract {
+
+// Guards the reference counts of all mappings.
+static CCUtilMutex refs_mutex;
+
+MappedFile *MappedFile::Open(const char *filename) {
+#ifdef _WIN32
+  return NULL;
+#else
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat info;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);  // The mapping stays valid without the descriptor.
+  if (data == MAP_FAILED) return NULL;
+  return new MappedFile(static_cast<char *>(data), info.st_size);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  munmap(data_, size_);
+#endif
+}
+
+void MappedFile::AddRef() {
+  refs_mutex.Lock();
+  ++refs_;
+  refs_mutex.Unlock();
+}
+
+void MappedFile::Release() {
+  refs_mutex.Lock();
+  bool last = --refs_ == 0;
+  refs_mutex.Unlock();
+  if (last) delete this;
+}
+
+FILE *MappedFile::OpenStream() const {
+#if defined(_WIN32) || defined(__APPLE__)
+  return NULL;
+#else
+  return fmemopen(data_, size_, "rb");
+#endif
+}
+
+}  // namespace tesseract
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////
+// File:        mappedfile.h
+// Description: Read-only memory mapping of a whole data file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#ifndef TESSERACT_CCUTIL_MAPPEDFILE_H_
+#define TESSERACT_CCUTIL_MAPPEDFILE_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+namespace tesseract {
+
+// A whole file mapped read-only into memory, so its pages come from the page
+// cache and are shared between processes. Writing to data() faults. It is
+// reference counted, so data used in place can outlive the TessdataManager
+// that opened it.
+class MappedFile {
+ public:
+  // Maps the given file with one reference. Returns NULL if the file can
+  // not be mapped, e.g. on platforms without mmap.
+  static MappedFile *Open(const char *filename);
+
+  void AddRef();
+  // Drops a reference, unmapping the file with the last one.
+  void Release();
+
+  // Returns a stdio stream reading the mapping, or NULL if the platform
+  // has no memory streams. The stream does not hold a reference.
+  FILE *OpenStream() const;
+
+  char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(char *data, size_t size) : data_(data), size_(size), refs_(1) {}
+  ~MappedFile();
+
+  char *data_;
+  size_t size_;
+  int refs_;
+};
+
+}  // namespace tesseract
+
+#endif  // TESSERACT_CCUTIL_MAPPEDFILE_H_
@@ -37,7 +37,11 @@ bool TessdataManager::Init(const char *data_file_name, int debug_level) {
   int i;
   debug_level_ = debug_level;
   data_file_name_ = data_file_name;
-  data_file_ = fopen(data_file_name, "rb");
+  // Read through a memory mapping where possible; components can then be
+  // parsed from, or used in place in, the shared page cache.
+  mapping_ = MappedFile::Open(data_file_name);
+  data_file_ = mapping_ != NULL ? mapping_->OpenStream() : NULL;
+  if (data_file_ == NULL) data_file_ = fopen(data_file_name, "rb");
   if (data_file_ == NULL) {
     tprintf("Error opening data file %s\n", data_file_name);
     tprintf("Please make sure the TESSDATA_PREFIX environment variable is set "
@@ -23,6 +23,7 @@
 #include <stdio.h>
 
 #include "host.h"
+#include "mappedfile.h"
 #include "strngs.h"
 #include "tprintf.h"
 
@@ -134,6 +135,7 @@ class TessdataManager {
  public:
   TessdataManager() {
     data_file_ = NULL;
+    mapping_ = NULL;
     actual_tessdata_num_entries_ = 0;
     for (int i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
       offset_table_[i] = -1;
@@ -154,6 +156,13 @@ class TessdataManager {
   /** Returns data file pointer. */
   inline FILE *GetDataFilePtr() const { return data_file_; }
 
+  /**
+   * Returns the memory mapping of the data file, or NULL if it could not be
+   * mapped. Offsets from GetDataFilePtr() index into it. Call AddRef() on it
+   * to use its data in place after End().
+   */
+  inline MappedFile *GetMapping() const { return mapping_; }
+
   /**
    * Returns false if there is no data of the given type.
    * Otherwise does a seek on the data_file_ to position the pointer
@@ -194,6 +203,10 @@ class TessdataManager {
       fclose(data_file_);
       data_file_ = NULL;
     }
+    if (mapping_ != NULL) {
+      mapping_->Release();
+      mapping_ = NULL;
+    }
   }
   bool swap() const {
     return swap_;
@@ -288,6 +301,7 @@ class TessdataManager {
   inT32 actual_tessdata_num_entries_;
   STRING data_file_name_;  // name of the data file.
   FILE *data_file_;  ///< pointer to the data file.
+  MappedFile *mapping_;  ///< the data file in memory, or NULL.
   int debug_level_;
   // True if the bytes need swapping.
   bool swap_;
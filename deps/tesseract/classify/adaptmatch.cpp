@@ -29,6 +29,7 @@
 #include "blobclass.h"
 #include "blobs.h"
 #include "callcpp.h"
+#include "classifier_cache.h"
 #include "classify.h"
 #include "const.h"
 #include "dict.h"
@@ -481,6 +482,14 @@ void Classify::EndAdaptiveClassifier() {
     BackupAdaptedTemplates = NULL;
   }
 
+  if (static_data_ != NULL) {
+    // The pre-trained data is shared, so just release our reference.
+    GlobalClassifierCache()->Free(static_data_);
+    static_data_ = NULL;
+    PreTrainedTemplates = NULL;
+    shape_table_ = NULL;
+    NormProtos = NULL;
+  }
   if (PreTrainedTemplates != NULL) {
     free_int_templates(PreTrainedTemplates);
     PreTrainedTemplates = NULL;
@@ -505,6 +514,42 @@ void Classify::EndAdaptiveClassifier() {
   }
 }                                /* EndAdaptiveClassifier */
 
+ClassifierCache *Classify::GlobalClassifierCache() {
+  // Like the dawg cache, this singleton outlives every Tesseract instance.
+  static ClassifierCache cache;
+  return &cache;
+}
+
+StaticClassifierData *Classify::LoadStaticClassifierData() {
+  StaticClassifierData *data = new StaticClassifierData;
+  ASSERT_HOST(tessdata_manager.SeekToStart(TESSDATA_INTTEMP));
+  data->templates = ReadIntTemplates(tessdata_manager.GetDataFilePtr());
+  if (tessdata_manager.DebugLevel() > 0) tprintf("Loaded inttemp\n");
+  // ReadIntTemplates filled our font tables; keep a copy for other instances.
+  CopyFontTables(fontinfo_table_, fontset_table_,
+                 &data->fontinfo_table, &data->fontset_table);
+
+  data->unicharset.CopyFrom(unicharset);
+  if (tessdata_manager.SeekToStart(TESSDATA_SHAPE_TABLE)) {
+    data->shape_table = new ShapeTable(data->unicharset);
+    if (!data->shape_table->DeSerialize(tessdata_manager.swap(),
+                                        tessdata_manager.GetDataFilePtr())) {
+      tprintf("Error loading shape table!\n");
+      delete data->shape_table;
+      data->shape_table = NULL;
+    } else if (tessdata_manager.DebugLevel() > 0) {
+      tprintf("Successfully loaded shape table!\n");
+    }
+  }
+
+  ASSERT_HOST(tessdata_manager.SeekToStart(TESSDATA_NORMPROTO));
+  data->norm_protos =
+    ReadNormProtos(tessdata_manager.GetDataFilePtr(),
+                   tessdata_manager.GetEndOffset(TESSDATA_NORMPROTO));
+  if (tessdata_manager.DebugLevel() > 0) tprintf("Loaded normproto\n");
+  return data;
+}
+
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -534,21 +579,20 @@ void Classify::InitAdaptiveClassifier(bool load_pre_trained_templates) {
   // adaptive only.
   if (language_data_path_prefix.length() > 0 &&
       load_pre_trained_templates) {
-    ASSERT_HOST(tessdata_manager.SeekToStart(TESSDATA_INTTEMP));
-    PreTrainedTemplates =
-      ReadIntTemplates(tessdata_manager.GetDataFilePtr());
-    if (tessdata_manager.DebugLevel() > 0) tprintf("Loaded inttemp\n");
-
-    if (tessdata_manager.SeekToStart(TESSDATA_SHAPE_TABLE)) {
-      shape_table_ = new ShapeTable(unicharset);
-      if (!shape_table_->DeSerialize(tessdata_manager.swap(),
-                                     tessdata_manager.GetDataFilePtr())) {
-        tprintf("Error loading shape table!\n");
-        delete shape_table_;
-        shape_table_ = NULL;
-      } else if (tessdata_manager.DebugLevel() > 0) {
-        tprintf("Successfully loaded shape table!\n");
-      }
+    // The templates, shape table and normalization protos are read-only, so
+    // they are loaded once per traineddata file and shared.
+    static_data_ = GlobalClassifierCache()->Get(
+        language_data_path_prefix + kTrainedDataSuffix,
+        NewTessCallback(this, &Classify::LoadStaticClassifierData));
+    ASSERT_HOST(static_data_ != NULL);
+    PreTrainedTemplates = static_data_->templates;
+    shape_table_ = static_data_->shape_table;
+    NormProtos = static_data_->norm_protos;
+    if (fontinfo_table_.size() == 0) {
+      // Another instance loaded the data, so take a copy of its fonts.
+      CopyFontTables(static_data_->fontinfo_table,
+                     static_data_->fontset_table,
+                     &fontinfo_table_, &fontset_table_);
     }
 
     ASSERT_HOST(tessdata_manager.SeekToStart(TESSDATA_PFFMTABLE));
@@ -557,12 +601,6 @@ void Classify::InitAdaptiveClassifier(bool load_pre_trained_templates) {
                    tessdata_manager.GetEndOffset(TESSDATA_PFFMTABLE),
                    CharNormCutoffs);
     if (tessdata_manager.DebugLevel() > 0) tprintf("Loaded pffmtable\n");
-
-    ASSERT_HOST(tessdata_manager.SeekToStart(TESSDATA_NORMPROTO));
-    NormProtos =
-      ReadNormProtos(tessdata_manager.GetDataFilePtr(),
-                     tessdata_manager.GetEndOffset(TESSDATA_NORMPROTO));
-    if (tessdata_manager.DebugLevel() > 0) tprintf("Loaded normproto\n");
     static_classifier_ = new TessClassifier(false, this);
   }
 
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////
+// File:        classifier_cache.cpp
+// Description: Shares the read-only static classifier data between
+//              Classify instances using the same traineddata file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#include "classifier_cache.h"
+
+#include <string.h>
+#include "normmatch.h"
+#include "shapetable.h"
+
+namespace tesseract {
+
+StaticClassifierData::StaticClassifierData()
+    : templates(NULL), shape_table(NULL), norm_protos(NULL) {
+  fontinfo_table.set_compare_callback(
+      NewPermanentTessCallback(CompareFontInfo));
+  fontinfo_table.set_clear_callback(
+      NewPermanentTessCallback(FontInfoDeleteCallback));
+  fontset_table.set_compare_callback(
+      NewPermanentTessCallback(CompareFontSet));
+  fontset_table.set_clear_callback(
+      NewPermanentTessCallback(FontSetDeleteCallback));
+}
+
+StaticClassifierData::~StaticClassifierData() {
+  if (templates != NULL) free_int_templates(templates);
+  delete shape_table;
+  FreeNormProtoSet(norm_protos);
+}
+
+void CopyFontTables(const UnicityTable<FontInfo> &fontinfo_from,
+                    const UnicityTable<FontSet> &fontset_from,
+                    UnicityTable<FontInfo> *fontinfo_to,
+                    UnicityTable<FontSet> *fontset_to) {
+  fontinfo_to->reserve(fontinfo_from.size());
+  for (int i = 0; i < fontinfo_from.size(); ++i) {
+    FontInfo fi = fontinfo_from.get(i);
+    if (fi.name != NULL) {
+      char *name = new char[strlen(fi.name) + 1];
+      strcpy(name, fi.name);
+      fi.name = name;
+    }
+    if (fi.spacing_vec != NULL) {
+      GenericVector<FontSpacingInfo *> *spacing_vec =
+          new GenericVector<FontSpacingInfo *>;
+      for (int s = 0; s < fi.spacing_vec->size(); ++s) {
+        FontSpacingInfo *spacing = (*fi.spacing_vec)[s];
+        spacing_vec->push_back(spacing != NULL ? new FontSpacingInfo(*spacing)
+                                               : NULL);
+      }
+      fi.spacing_vec = spacing_vec;
+    }
+    fontinfo_to->push_back(fi);
+  }
+  fontset_to->reserve(fontset_from.size());
+  for (int i = 0; i < fontset_from.size(); ++i) {
+    FontSet fs = fontset_from.get(i);
+    int32_t *configs = new int32_t[fs.size];
+    memcpy(configs, fs.configs, fs.size * sizeof(*configs));
+    fs.configs = configs;
+    fontset_to->push_back(fs);
+  }
+}
+
+}  // namespace tesseract
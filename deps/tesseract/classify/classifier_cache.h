@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////
+// File:        classifier_cache.h
+// Description: Shares the read-only static classifier data between
+//              Classify instances using the same traineddata file.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////
+
+#ifndef TESSERACT_CLASSIFY_CLASSIFIER_CACHE_H_
+#define TESSERACT_CLASSIFY_CLASSIFIER_CACHE_H_
+
+#include "fontinfo.h"
+#include "intproto.h"
+#include "object_cache.h"
+#include "strngs.h"
+#include "unicharset.h"
+#include "unicity_table.h"
+
+struct NORM_PROTOS;
+
+namespace tesseract {
+
+class ShapeTable;
+
+// The pre-trained templates, shape table and normalization protos of a
+// traineddata file. Nothing modifies them after loading, so one copy is
+// shared by every Classify that uses the file. The adaptive templates and
+// cutoffs stay per instance.
+struct StaticClassifierData {
+  StaticClassifierData();
+  ~StaticClassifierData();
+
+  INT_TEMPLATES templates;
+  ShapeTable *shape_table;
+  NORM_PROTOS *norm_protos;
+  // The unicharset shape_table refers to, as it outlives any one instance.
+  UNICHARSET unicharset;
+  // Copied into each Classify, as the font tables are value members there.
+  UnicityTable<FontInfo> fontinfo_table;
+  UnicityTable<FontSet> fontset_table;
+};
+
+// Deep copies font tables, so each copy can free its own entries.
+void CopyFontTables(const UnicityTable<FontInfo> &fontinfo_from,
+                    const UnicityTable<FontSet> &fontset_from,
+                    UnicityTable<FontInfo> *fontinfo_to,
+                    UnicityTable<FontSet> *fontset_to);
+
+class ClassifierCache {
+ public:
+  // Returns the data for data_file_name, running loader if it is not cached
+  // yet. Every successful Get() must be followed by a Free().
+  StaticClassifierData *Get(const STRING &data_file_name,
+                            TessResultCallback<StaticClassifierData *> *loader) {
+    return data_.Get(data_file_name, loader);
+  }
+
+  // Decrements the count of data, which stays cached until
+  // DeleteUnusedData(). Returns false if data is not managed by us.
+  bool Free(StaticClassifierData *data) {
+    return data_.Free(data);
+  }
+
+  // Free up any currently unused data.
+  void DeleteUnusedData() {
+    data_.DeleteUnusedObjects();
+  }
+
+ private:
+  ObjectCache<StaticClassifierData> data_;
+};
+
+}  // namespace tesseract
+
+#endif  // TESSERACT_CLASSIFY_CLASSIFIER_CACHE_H_
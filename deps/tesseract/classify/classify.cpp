@@ -161,7 +161,8 @@ Classify::Classify()
                     "Penalty to add to worst rating for noise", this->params()),
       shape_table_(NULL),
       dict_(this),
-      static_classifier_(NULL) {
+      static_classifier_(NULL),
+      static_data_(NULL) {
   fontinfo_table_.set_compare_callback(
       NewPermanentTessCallback(CompareFontInfo));
   fontinfo_table_.set_clear_callback(
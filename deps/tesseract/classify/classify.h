@@ -44,9 +44,11 @@ static const int kBlankFontinfoId = -2;
 
 namespace tesseract {
 
+class ClassifierCache;
 class ShapeClassifier;
 struct ShapeRating;
 class ShapeTable;
+struct StaticClassifierData;
 struct UnicharRating;
 
 // How segmented is a blob. In this enum, character refers to a classifiable
@@ -139,6 +141,11 @@ class Classify : public CCStruct {
                    CharSegmentationType segmentation, const char* correct_text,
                    WERD_RES* word);
   void InitAdaptiveClassifier(bool load_pre_trained_templates);
+  // The cache of pre-trained classifier data shared by all instances.
+  static ClassifierCache *GlobalClassifierCache();
+  // Loads the pre-trained classifier data from tessdata_manager, for
+  // GlobalClassifierCache() to share.
+  StaticClassifierData *LoadStaticClassifierData();
   void InitAdaptedClass(TBLOB *Blob,
                         CLASS_ID ClassId,
                         int FontinfoId,
@@ -469,6 +476,8 @@ class Classify : public CCStruct {
             "Integer Matcher Multiplier  0-255:   ");
 
   // Use class variables to hold onto built-in templates and adapted templates.
+  // PreTrainedTemplates, shape_table_ and NormProtos point into static_data_,
+  // which is shared with other instances and must not be modified.
   INT_TEMPLATES PreTrainedTemplates;
   ADAPT_TEMPLATES AdaptedTemplates;
   // The backup adapted templates are created from the previous page (only)
@@ -515,6 +524,8 @@ class Classify : public CCStruct {
   Dict dict_;
   // The currently active static classifier.
   ShapeClassifier* static_classifier_;
+  // The shared pre-trained classifier data, owned by GlobalClassifierCache().
+  StaticClassifierData* static_data_;
 
   /* variables used to hold performance statistics */
   int NumAdaptationsFailed;
@@ -160,17 +160,21 @@ FLOAT32 Classify::ComputeNormMatch(CLASS_ID ClassId,
 }                                /* ComputeNormMatch */
 
 void Classify::FreeNormProtos() {
-  if (NormProtos != NULL) {
-    for (int i = 0; i < NormProtos->NumProtos; i++)
-      FreeProtoList(&NormProtos->Protos[i]);
-    Efree(NormProtos->Protos);
-    Efree(NormProtos->ParamDesc);
-    Efree(NormProtos);
-    NormProtos = NULL;
-  }
+  FreeNormProtoSet(NormProtos);
+  NormProtos = NULL;
 }
 }  // namespace tesseract
 
+void FreeNormProtoSet(NORM_PROTOS *norm_protos) {
+  if (norm_protos != NULL) {
+    for (int i = 0; i < norm_protos->NumProtos; i++)
+      FreeProtoList(&norm_protos->Protos[i]);
+    Efree(norm_protos->Protos);
+    Efree(norm_protos->ParamDesc);
+    Efree(norm_protos);
+  }
+}
+
 /*----------------------------------------------------------------------------
               Private Code
 ----------------------------------------------------------------------------*/
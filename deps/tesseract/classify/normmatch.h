@@ -25,6 +25,13 @@
 #include "ocrfeatures.h"
 #include "params.h"
 
+struct NORM_PROTOS;
+
+/**----------------------------------------------------------------------------
+          Public Function Prototypes
+----------------------------------------------------------------------------**/
+void FreeNormProtoSet(NORM_PROTOS *norm_protos);
+
 /**----------------------------------------------------------------------------
         Variables
 ----------------------------------------------------------------------------**/
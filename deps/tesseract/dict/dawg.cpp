@@ -196,7 +196,13 @@ void Dawg::init(DawgType type, const STRING &lang,
          F u n c t i o n s   f o r   S q u i s h e d    D a w g
 ----------------------------------------------------------------------*/
 
-SquishedDawg::~SquishedDawg() { delete[] edges_; }
+SquishedDawg::~SquishedDawg() {
+  if (mapping_ != NULL) {
+    mapping_->Release();
+  } else {
+    delete[] edges_;
+  }
+}
 
 EDGE_REF SquishedDawg::edge_char_of(NODE_REF node,
                                     UNICHAR_ID unichar_id,
@@ -318,7 +324,8 @@ void SquishedDawg::read_squished_dawg(FILE *file,
                                       DawgType type,
                                       const STRING &lang,
                                       PermuterType perm,
-                                      int debug_level) {
+                                      int debug_level,
+                                      MappedFile *mapping) {
   if (debug_level) tprintf("Reading squished dawg\n");
 
   // Read the magic number and if it does not match kDawgMagicNumber
@@ -338,8 +345,20 @@ void SquishedDawg::read_squished_dawg(FILE *file,
   ASSERT_HOST(num_edges_ > 0);  // DAWG should not be empty
   Dawg::init(type, lang, perm, unicharset_size, debug_level);
 
-  edges_ = new EDGE_RECORD[num_edges_];
-  fread(&edges_[0], sizeof(EDGE_RECORD), num_edges_, file);
+  // The edges are a flat array, so use them straight from the mapping when
+  // they need no swapping and happen to be aligned in the file.
+  long offset = mapping != NULL && !swap ? ftell(file) : -1;
+  size_t edges_size = sizeof(EDGE_RECORD) * num_edges_;
+  if (offset >= 0 && offset % sizeof(EDGE_RECORD) == 0 &&
+      offset + edges_size <= mapping->size()) {
+    mapping_ = mapping;
+    mapping_->AddRef();
+    edges_ = reinterpret_cast<EDGE_ARRAY>(mapping->data() + offset);
+    fseek(file, edges_size, SEEK_CUR);
+  } else {
+    edges_ = new EDGE_RECORD[num_edges_];
+    fread(&edges_[0], sizeof(EDGE_RECORD), num_edges_, file);
+  }
   EDGE_REF edge;
   if (swap) {
     for (edge = 0; edge < num_edges_; ++edge) {
@@ -417,11 +436,11 @@ void SquishedDawg::write_squished_dawg(FILE *file) {
   for (edge = 0; edge < num_edges_; edge++) {
     if (forward_edge(edge)) {  // write forward edges
       do {
+        // Remap a copy, the edges may live in a read-only mapping.
         old_index = next_node_from_edge_rec(edges_[edge]);
-        set_next_node(edge, node_map[old_index]);
         temp_record = edges_[edge];
+        set_next_node_in_edge_rec(&temp_record, node_map[old_index]);
         fwrite(&(temp_record), sizeof(EDGE_RECORD), 1, file);
-        set_next_node(edge, old_index);
       } while (!last_edge(edge++));
 
       if (edge >= num_edges_) break;
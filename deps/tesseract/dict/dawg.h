@@ -32,6 +32,7 @@
 ----------------------------------------------------------------------*/
 
 #include "elst.h"
+#include "mappedfile.h"
 #include "ratngs.h"
 #include "params.h"
 #include "tesscallback.h"
@@ -407,13 +408,16 @@ class DawgPositionVector : public GenericVector<DawgPosition> {
 //
 class SquishedDawg : public Dawg {
  public:
+  // If file reads from mapping, the edges are used in place where possible.
   SquishedDawg(FILE *file, DawgType type, const STRING &lang,
-               PermuterType perm, int debug_level) {
-    read_squished_dawg(file, type, lang, perm, debug_level);
+               PermuterType perm, int debug_level,
+               MappedFile *mapping = NULL) : mapping_(NULL) {
+    read_squished_dawg(file, type, lang, perm, debug_level, mapping);
     num_forward_edges_in_node0 = num_forward_edges(0);
   }
   SquishedDawg(const char* filename, DawgType type,
-               const STRING &lang, PermuterType perm, int debug_level) {
+               const STRING &lang, PermuterType perm, int debug_level)
+      : mapping_(NULL) {
     FILE *file = fopen(filename, "rb");
     if (file == NULL) {
       tprintf("Failed to open dawg file %s\n", filename);
@@ -426,7 +430,7 @@ class SquishedDawg : public Dawg {
   SquishedDawg(EDGE_ARRAY edges, int num_edges, DawgType type,
                const STRING &lang, PermuterType perm,
                int unicharset_size, int debug_level) :
-    edges_(edges), num_edges_(num_edges) {
+    edges_(edges), num_edges_(num_edges), mapping_(NULL) {
     init(type, lang, perm, unicharset_size, debug_level);
     num_forward_edges_in_node0 = num_forward_edges(0);
     if (debug_level > 3) print_all("SquishedDawg:");
@@ -528,9 +532,11 @@ class SquishedDawg : public Dawg {
   /// Counts and returns the number of forward edges in this node.
   inT32 num_forward_edges(NODE_REF node) const;
 
-  /// Reads SquishedDawg from a file.
+  /// Reads SquishedDawg from a file. If file reads from mapping and the
+  /// edges need no byte swapping, edges_ points into the mapping.
   void read_squished_dawg(FILE *file, DawgType type, const STRING &lang,
-                          PermuterType perm, int debug_level);
+                          PermuterType perm, int debug_level,
+                          MappedFile *mapping = NULL);
 
   /// Prints the contents of an edge indicated by the given EDGE_REF.
   void print_edge(EDGE_REF edge) const;
@@ -549,6 +555,8 @@ class SquishedDawg : public Dawg {
   EDGE_ARRAY edges_;
   int num_edges_;
   int num_forward_edges_in_node0;
+  // The mapping edges_ points into, or NULL if edges_ is owned.
+  MappedFile *mapping_;
 };
 
 }  // namespace tesseract
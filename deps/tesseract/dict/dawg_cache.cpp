@@ -97,7 +97,8 @@ Dawg *DawgLoader::Load() {
       return NULL;
   }
   SquishedDawg *retval =
-      new SquishedDawg(fp, dawg_type, lang_, perm_type, dawg_debug_level_);
+      new SquishedDawg(fp, dawg_type, lang_, perm_type, dawg_debug_level_,
+                       data_loader.GetMapping());
   data_loader.End();
   return retval;
 }
@@ -117,6 +117,7 @@
         'ccutil/globaloc.cpp',
         'ccutil/indexmapbidi.cpp',
         'ccutil/mainblk.cpp',
+        'ccutil/mappedfile.cpp',
         'ccutil/memry.cpp',
         'ccutil/params.cpp',
         'ccutil/scanutils.cpp',
@@ -132,6 +133,7 @@
         'classify/adaptive.cpp',
         'classify/adaptmatch.cpp',
         'classify/blobclass.cpp',
+        'classify/classifier_cache.cpp',
         'classify/classify.cpp',
         'classify/cluster.cpp',
         'classify/clusttool.cpp',
@@ -10,6 +10,61 @@ var fs = require('fs');
 var path = require('path');
 var binding = require(__dirname + '/dvBinding.node');
 
+// Wrap a native method taking a trailing (err, result) callback into a
+// Promise-returning one.
+var promisify = function(method) {
+    return function() {
+        var self = this;
+        var args = Array.prototype.slice.call(arguments);
+        return new Promise(function(resolve, reject) {
+            args.push(function(err, result) {
+                if (err) {
+                    reject(err);
+                } else {
+                    resolve(result);
+                }
+            });
+            method.apply(self, args);
+        });
+    };
+};
+
+// Like promisify, but honours an AbortSignal passed as options.signal (the
+// last argument) by calling cancel with the value the method returned.
+var promisifyCancelable = function(method, cancel) {
+    return function() {
+        var self = this;
+        var args = Array.prototype.slice.call(arguments);
+        var options = args[args.length - 1];
+        var signal = options !== null && typeof options === 'object' ? options.signal : undefined;
+        return new Promise(function(resolve, reject) {
+            var onAbort;
+            if (signal && signal.aborted) {
+                var err = new Error('Recognition cancelled');
+                err.code = 'ECANCELED';
+                return reject(err);
+            }
+            args.push(function(err, result) {
+                if (onAbort) {
+                    signal.removeEventListener('abort', onAbort);
+                }
+                if (err) {
+                    reject(err);
+                } else {
+                    resolve(result);
+                }
+            });
+            var job = method.apply(self, args);
+            if (signal) {
+                onAbort = function() {
+                    cancel.call(self, job);
+                };
+                signal.addEventListener('abort', onAbort);
+            }
+        });
+    };
+};
+
 // Wrap and export Tesseract.
 var Tesseract = exports.Tesseract = function(lang, image, tessdata) {
     tessdata = tessdata || require('dv.data').tessdata;
@@ -29,7 +84,125 @@ Tesseract.prototype = {
     __proto__: binding.Tesseract.prototype,
     constructor: Tesseract,
 };
+['findRegionsAsync', 'findParagraphsAsync', 'findTextLinesAsync',
+ 'findWordsAsync', 'findSymbolsAsync', 'findTextAsync', 'recognizeAsync',
+ 'resultsAsync', 'recognizeRegions'].forEach(function(name) {
+    Tesseract.prototype[name] = promisifyCancelable(binding.Tesseract.prototype[name],
+                                                    binding.Tesseract.prototype.cancel);
+});
+
+// Iterate over results at the given level ('region', 'paragraph', 'textline',
+// 'word' or 'symbol') with for await. Results are extracted in chunks of
+// options.chunkSize on a worker thread, one chunk ahead of the consumer.
+// The instance stays locked until the iterator is exhausted or returned.
+Tesseract.prototype.iterate = function(level, options) {
+    var self = this;
+    options = options || {};
+    var chunkSize = options.chunkSize || 256;
+    var chunk = [];
+    var index = 0;
+    var begun = false;
+    var exhausted = false;
+    var closed = false;
+    var fetch = function() {
+        return new Promise(function(resolve, reject) {
+            self.iterateNext(chunkSize, function(err, results, last) {
+                if (err) {
+                    reject(err);
+                } else {
+                    exhausted = last;
+                    resolve(results);
+                }
+            });
+        });
+    };
+    var prefetch = new Promise(function(resolve, reject) {
+        self.iterateBegin(level, options, function(err, hasResults) {
+            if (err) {
+                reject(err);
+            } else {
+                begun = true;
+                exhausted = !hasResults;
+                if (closed && hasResults) {
+                    // Returned before recognition finished.
+                    self.iterateEnd();
+                }
+                resolve(exhausted || closed ? [] : fetch());
+            }
+        });
+    });
+    var step = function() {
+        if (index < chunk.length) {
+            return {value: chunk[index++], done: false};
+        }
+        if (closed || prefetch === null) {
+            return {value: undefined, done: true};
+        }
+        return prefetch.then(function(results) {
+            chunk = results;
+            index = 0;
+            prefetch = exhausted || closed ? null : fetch();
+            return step();
+        });
+    };
+    var pending = Promise.resolve();
+    var iterator = {
+        next: function() {
+            var result = pending.then(step);
+            pending = result.catch(function() {});
+            return result;
+        },
+        return: function() {
+            if (begun && !closed && !exhausted) {
+                self.iterateEnd();
+            }
+            closed = true;
+            return Promise.resolve({value: undefined, done: true});
+        },
+    };
+    if (typeof Symbol !== 'undefined' && Symbol.asyncIterator) {
+        iterator[Symbol.asyncIterator] = function() {
+            return this;
+        };
+    }
+    return iterator;
+};
+
+// Wrap and export TesseractPool. Jobs run on the libuv threadpool, so by
+// default the pool has no more engines than that has threads; raise
+// UV_THREADPOOL_SIZE before the first async call to use more.
+var TesseractPool = exports.TesseractPool = function(lang, size, tessdata) {
+    tessdata = tessdata || require('dv.data').tessdata;
+    lang = lang || 'eng';
+    size = size || Math.min(require('os').cpus().length,
+                            Number(process.env.UV_THREADPOOL_SIZE) || 4);
+    var pool = new binding.TesseractPool(tessdata, lang, size);
+    pool.__proto__ = TesseractPool.prototype;
+    return pool;
+};
+TesseractPool.prototype = {
+    __proto__: binding.TesseractPool.prototype,
+    constructor: TesseractPool,
+    recognize: promisifyCancelable(binding.TesseractPool.prototype.recognize,
+                                   binding.TesseractPool.prototype.cancel),
+    recognizeRegions: promisifyCancelable(binding.TesseractPool.prototype.recognizeRegions,
+                                          binding.TesseractPool.prototype.cancel),
+};
+
+// Export the process-wide Pix buffer pool, configured with
+// {sizes: [bytes, ...], counts: [n, ...]} or null to disable it.
+exports.setPixPool = binding.setPixPool;
+exports.pixPoolStats = binding.pixPoolStats;
+
+// Export Image with Promise-returning asynchronous methods.
+var Image = exports.Image = binding.Image;
+Image.decode = promisify(binding.Image.decode);
+Image.prototype.toBufferAsync = promisify(binding.Image.prototype.toBufferAsync);
+Image.prototype.pipeline = promisify(binding.Image.prototype.pipeline);
+
+// Export PageCache.
+exports.PageCache = binding.PageCache;
 
-// Export others.
-exports.Image = binding.Image;
-exports.ZXing = binding.ZXing;
+// Export ZXing with Promise-returning asynchronous decoding.
+var ZXing = exports.ZXing = binding.ZXing;
+ZXing.prototype.findCodeAsync = promisify(binding.ZXing.prototype.findCodeAsync);
@@ -0,0 +1,124 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#include "deflate.h"
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace binding {
+
+namespace {
+
+// Bands smaller than this are not worth a thread.
+const size_t minBandSize = 128 * 1024;
+
+unsigned adler32(const unsigned char *data, size_t length)
+{
+    unsigned s1 = 1;
+    unsigned s2 = 0;
+    while (length > 0) {
+        // At most 5552 bytes fit before s2 overflows.
+        size_t amount = length > 5552 ? 5552 : length;
+        length -= amount;
+        while (amount-- > 0) {
+            s1 += *data++;
+            s2 += s1;
+        }
+        s1 %= 65521;
+        s2 %= 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
+struct Band
+{
+    Band() : data(NULL), size(0), error(0) {}
+    unsigned char *data;
+    size_t size;
+    unsigned error;
+};
+
+void deflateBand(Band *band, const unsigned char *in, size_t insize, bool final,
+                 const LodePNGCompressSettings *settings)
+{
+    band->error = lodepng_deflate_band(&band->data, &band->size, in, insize, final, settings);
+}
+
+}
+
+unsigned parallelZlibCompress(unsigned char **out, size_t *outsize,
+                              const unsigned char *in, size_t insize,
+                              const LodePNGCompressSettings *settings)
+{
+    int threads = settings->custom_context ? *static_cast<const int *>(settings->custom_context) : 1;
+    size_t count = insize / minBandSize;
+    if (count > static_cast<size_t>(threads)) {
+        count = threads;
+    }
+    if (count < 1) {
+        count = 1;
+    }
+    size_t bandSize = (insize + count - 1) / count;
+
+    std::vector<Band> bands(count);
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+    for (size_t i = 1; i < count; ++i) {
+        size_t start = i * bandSize;
+        size_t length = i + 1 == count ? insize - start : bandSize;
+        try {
+            workers.push_back(std::thread(deflateBand, &bands[i], in + start, length,
+                                          i + 1 == count, settings));
+        } catch (const std::system_error &) {
+            // Out of threads: deflate this band here instead.
+            deflateBand(&bands[i], in + start, length, i + 1 == count, settings);
+        }
+    }
+    deflateBand(&bands[0], in, count == 1 ? insize : bandSize, count == 1, settings);
+    unsigned checksum = adler32(in, insize);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    unsigned error = 0;
+    size_t total = 6;
+    for (size_t i = 0; i < count; ++i) {
+        error = error ? error : bands[i].error;
+        total += bands[i].size;
+    }
+    if (!error) {
+        // Same header as lodepng: deflate with a 32K window, no dictionary.
+        unsigned char *data = static_cast<unsigned char *>(realloc(*out, *outsize + total));
+        if (!data) {
+            error = 83;
+        } else {
+            unsigned char *p = data + *outsize;
+            *p++ = 0x78;
+            *p++ = 0x01;
+            for (size_t i = 0; i < count; ++i) {
+                memcpy(p, bands[i].data, bands[i].size);
+                p += bands[i].size;
+            }
+            *p++ = static_cast<unsigned char>(checksum >> 24);
+            *p++ = static_cast<unsigned char>(checksum >> 16);
+            *p++ = static_cast<unsigned char>(checksum >> 8);
+            *p++ = static_cast<unsigned char>(checksum);
+            *out = data;
+            *outsize += total;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        free(bands[i].data);
+    }
+    return error;
+}
+
+}
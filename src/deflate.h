@@ -0,0 +1,26 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <lodepng.h>
+
+namespace binding {
+
+// Zlib compressor for LodePNGCompressSettings::custom_zlib that deflates
+// independent bands of the input on custom_context (an int, the number of
+// threads) threads and joins them with sync flushes. Each band starts with
+// an empty window, so the output is slightly larger than a serial deflate.
+unsigned parallelZlibCompress(unsigned char **out, size_t *outsize,
+                              const unsigned char *in, size_t insize,
+                              const LodePNGCompressSettings *settings);
+
+}
+
+#endif
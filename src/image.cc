@@ -7,10 +7,16 @@
  * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
  */
 #include "image.h"
+#include "deflate.h"
+#include "ingest.h"
+#include "pipeline.h"
 #include "util.h"
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <set>
 #include <node_buffer.h>
 #include <lodepng.h>
 #include <jpgd.h>
@@ -31,22 +37,59 @@ using namespace v8;
 
 namespace binding {
 
-Nan::Persistent<FunctionTemplate> Image::constructor_template;
+#define CheckDisposed(obj) if (!(obj)->pix_) return Nan::ThrowError("Image is empty or disposed")
+
+PerIsolate<FunctionTemplate> Image::constructor_template;
+
+// Pix whose data is borrowed from a Buffer (see the wrap option). Leptonica
+// must never free that data, so these Pix are copied rather than cloned.
+static std::set<Pix*> wrappedPix;
+static std::mutex wrappedPixMutex;
+
+#ifdef L_BIG_ENDIAN
+static const char *const hostByteOrder = "BE";
+#else
+static const char *const hostByteOrder = "LE";
+#endif
+
+static bool isWrapped(Pix *pix)
+{
+    std::lock_guard<std::mutex> lock(wrappedPixMutex);
+    return wrappedPix.count(pix) != 0;
+}
+
+// Creates a Pix over caller-owned memory holding rows of 32bpp RGBA or 8bpp
+// gray pixels. The data must already be in Leptonica's word order, i.e.
+// 32-bit words in host byte order; it is never written here.
+PIX *pixWrapSource(uint8_t *pixSource, int32_t width, int32_t height, int32_t depth, int32_t stride)
+{
+    PIX *pix = pixCreateHeader(width, height, depth);
+    if (!pix) {
+        return NULL;
+    }
+    pixSetWpl(pix, stride / 4);
+    pixSetData(pix, reinterpret_cast<l_uint32 *>(pixSource));
+    std::lock_guard<std::mutex> lock(wrappedPixMutex);
+    wrappedPix.insert(pix);
+    return pix;
+}
 
 PIX *pixFromSource(uint8_t *pixSource, int32_t width, int32_t height, int32_t depth, int32_t targetDepth)
 {
-    // Create PIX and copy pixels from source.
+    // Create PIX and convert pixels from source, row by row.
     PIX *pix = pixCreateNoInit(width, height, targetDepth);
+    if (!pix) {
+        return NULL;
+    }
     uint32_t *line = pix->data;
+    int bytesPerPixel = depth / 8;
     for (uint32_t y = 0; y < pix->h; ++y) {
-        for (uint32_t x = 0; x < pix->w; ++x) {
-            if (pix->d == 8) {
-                SET_DATA_BYTE(line, x, pixSource[0]);
-            } else {
-                composeRGBPixel(pixSource[0], pixSource[1], pixSource[2], &line[x]);
-            }
-            pixSource += depth / 8;
+        if (pix->d == 8) {
+            ingestGrayRow(pixSource, bytesPerPixel, line, width);
+        } else {
+            ingestRGBRow(pixSource, bytesPerPixel, line, width);
         }
+        pixSource += width * bytesPerPixel;
         line += pix->wpl;
     }
     return pix;
@@ -174,12 +217,611 @@ cv::Mat pix8ToMat(PIX *pix8)
     return mat;
 }
 
+enum ImageFormat
+{
+    FORMAT_INVALID = -1,
+    FORMAT_RAW = 0,
+    FORMAT_PNG = 1,
+    FORMAT_JPG = 2
+};
+
+ImageFormat toImageFormat(const char *format)
+{
+    if (strcmp("raw", format) == 0) {
+        return FORMAT_RAW;
+    } else if (strcmp("png", format) == 0) {
+        return FORMAT_PNG;
+    } else if (strcmp("jpg", format) == 0) {
+        return FORMAT_JPG;
+    } else {
+        return FORMAT_INVALID;
+    }
+}
+
+struct DecodeOptions
+{
+    DecodeOptions() : scaleShift(0), gray(false) {}
+    int scaleShift;
+    bool gray;
+};
+
+// Parses decode options {scale: 1|1/2|1/4|1/8, gray: Boolean}, the scale
+// into a power of two shift.
+bool toDecodeOptions(Local<Value> value, DecodeOptions *options)
+{
+    *options = DecodeOptions();
+    if (!value->IsObject()) {
+        return false;
+    }
+    Local<Object> object = value->ToObject();
+    options->gray = Nan::Get(object, Nan::New("gray").ToLocalChecked()).ToLocalChecked()->BooleanValue();
+    Local<Value> scale = Nan::Get(object, Nan::New("scale").ToLocalChecked()).ToLocalChecked();
+    if (scale->IsUndefined()) {
+        return true;
+    }
+    double factor = scale->NumberValue();
+    for (int shift = 0; shift <= 3; ++shift) {
+        if (factor == 1.0 / (1 << shift)) {
+            options->scaleShift = shift;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decodes a PNG or JPG image, JPGs optionally at 1/(1 << scaleShift) of
+// their size from reduced IDCTs. With gray set the result is 8 bit; JPGs
+// then only decode their luma channel. Does not touch V8, so it is safe to
+// call from worker threads.
+Pix *decodeImage(ImageFormat format, const unsigned char *in, size_t inLength,
+                 const DecodeOptions &options, std::string &error)
+{
+    Pix *pix = NULL;
+    if (format == FORMAT_PNG && options.scaleShift > 0) {
+        error = "scale is only supported for jpg";
+    } else if (format == FORMAT_PNG) {
+        std::vector<unsigned char> out;
+        unsigned int width;
+        unsigned int height;
+        lodepng::State state;
+        unsigned lodepngError = lodepng::decode(out, width, height, state, in, inLength);
+        if (lodepngError) {
+            std::stringstream msg;
+            msg << "error while decoding '" << lodepng_error_text(lodepngError) << "'";
+            error = msg.str();
+            return NULL;
+        }
+        if (state.info_png.color.colortype == LCT_GREY || state.info_png.color.colortype == LCT_GREY_ALPHA) {
+            pix = pixFromSource(&out[0], width, height, 32, 8);
+        } else {
+            pix = pixFromSource(&out[0], width, height, 32, 32);
+            if (pix && options.gray) {
+                Pix *gray = pixConvertRGBToLuminance(pix);
+                pixDestroy(&pix);
+                pix = gray;
+            }
+        }
+        if (!pix) {
+            error = "out of memory";
+        }
+    } else if (format == FORMAT_JPG) {
+        // Decode scan lines straight into the Pix.
+        jpgd::jpeg_decoder_mem_stream stream(in, static_cast<jpgd::uint>(inLength));
+        jpgd::jpeg_decoder decoder(&stream);
+        decoder.set_scale(options.scaleShift);
+        decoder.set_luma_only(options.gray);
+        if (decoder.get_error_code() != jpgd::JPGD_SUCCESS
+                || decoder.begin_decoding() != jpgd::JPGD_SUCCESS) {
+            error = "error while decoding jpg";
+            return NULL;
+        }
+        int bytesPerPixel = decoder.get_bytes_per_pixel();
+        pix = pixCreateNoInit(decoder.get_scaled_width(), decoder.get_scaled_height(),
+                              bytesPerPixel == 1 ? 8 : 32);
+        if (!pix) {
+            error = "out of memory";
+            return NULL;
+        }
+        uint32_t *line = pixGetData(pix);
+        for (int y = 0; y < decoder.get_scaled_height(); ++y) {
+            const void *scanLine;
+            jpgd::uint scanLineLength;
+            if (decoder.decode(&scanLine, &scanLineLength) != jpgd::JPGD_SUCCESS) {
+                pixDestroy(&pix);
+                error = "error while decoding jpg";
+                return NULL;
+            }
+            const uint8_t *source = static_cast<const uint8_t *>(scanLine);
+            if (bytesPerPixel == 1) {
+                ingestGrayRow(source, 1, line, pixGetWidth(pix));
+            } else {
+                ingestRGBRow(source, 4, line, pixGetWidth(pix));
+            }
+            line += pixGetWpl(pix);
+        }
+    } else {
+        error = "invalid buffer format";
+    }
+    return pix;
+}
+
+struct EncodeOptions
+{
+    EncodeOptions() : quality(-1), level(-1), filter(-1), window(0), lazy(-1), threads(1) {}
+    int quality;
+    int level;
+    int filter;
+    int window;
+    int lazy;
+    int threads;
+};
+
+// Parses {quality} for JPG or {fast, level: 0-9, filter, window, lazy,
+// threads} for PNG. Values that are neither a quality nor an object are
+// ignored, as they were before options existed. Returns an error message or
+// NULL.
+const char *toEncodeOptions(Local<Value> value, ImageFormat format, EncodeOptions *options)
+{
+    *options = EncodeOptions();
+    if (value->IsNumber()) {
+        if (format == FORMAT_JPG) {
+            options->quality = value->Int32Value();
+        }
+        return NULL;
+    } else if (!value->IsObject()) {
+        return NULL;
+    }
+    Local<Object> object = value->ToObject();
+    Local<Value> quality = Nan::Get(object, Nan::New("quality").ToLocalChecked()).ToLocalChecked();
+    if (format == FORMAT_JPG && quality->IsNumber()) {
+        options->quality = quality->Int32Value();
+    }
+    if (format != FORMAT_PNG) {
+        return NULL;
+    }
+    if (Nan::Get(object, Nan::New("fast").ToLocalChecked()).ToLocalChecked()->BooleanValue()) {
+        options->level = 1;
+        options->filter = LFS_ZERO;
+    }
+    Local<Value> level = Nan::Get(object, Nan::New("level").ToLocalChecked()).ToLocalChecked();
+    if (level->IsNumber()) {
+        options->level = level->Int32Value();
+        if (options->level < 0 || options->level > 9) {
+            return "level must be between 0 and 9";
+        }
+    }
+    Local<Value> filter = Nan::Get(object, Nan::New("filter").ToLocalChecked()).ToLocalChecked();
+    if (filter->IsString()) {
+        String::Utf8Value name(filter->ToString());
+        if (strcmp(*name, "zero") == 0) {
+            options->filter = LFS_ZERO;
+        } else if (strcmp(*name, "minsum") == 0) {
+            options->filter = LFS_MINSUM;
+        } else if (strcmp(*name, "entropy") == 0) {
+            options->filter = LFS_ENTROPY;
+        } else if (strcmp(*name, "brute") == 0) {
+            options->filter = LFS_BRUTE_FORCE;
+        } else {
+            return "filter must be 'zero', 'minsum', 'entropy' or 'brute'";
+        }
+    }
+    Local<Value> window = Nan::Get(object, Nan::New("window").ToLocalChecked()).ToLocalChecked();
+    if (window->IsNumber()) {
+        options->window = window->Int32Value();
+        if (options->window < 1 || options->window > 32768 || (options->window & (options->window - 1))) {
+            return "window must be a power of two up to 32768";
+        }
+    }
+    Local<Value> lazy = Nan::Get(object, Nan::New("lazy").ToLocalChecked()).ToLocalChecked();
+    if (lazy->IsBoolean()) {
+        options->lazy = lazy->BooleanValue();
+    }
+    Local<Value> threads = Nan::Get(object, Nan::New("threads").ToLocalChecked()).ToLocalChecked();
+    if (threads->IsNumber()) {
+        options->threads = std::min(std::max(threads->Int32Value(), 1), 64);
+    }
+    return NULL;
+}
+
+// Translates encode options into lodepng settings; the defaults are left
+// alone for options that were not given.
+void applyPngOptions(lodepng::State &state, const EncodeOptions &options)
+{
+    LodePNGCompressSettings &zlib = state.encoder.zlibsettings;
+    if (options.level == 0) {
+        zlib.btype = 0;
+    } else if (options.level > 0) {
+        static const unsigned niceMatch[] = { 0, 16, 32, 32, 64, 128, 128, 192, 258, 258 };
+        zlib.windowsize = 1u << std::min(options.level + 6, 15);
+        zlib.nicematch = niceMatch[options.level];
+        zlib.lazymatching = options.level >= 4;
+    }
+    if (options.window > 0) {
+        zlib.windowsize = options.window;
+    }
+    if (options.lazy >= 0) {
+        zlib.lazymatching = options.lazy;
+    }
+    if (options.filter >= 0) {
+        state.encoder.filter_strategy = static_cast<LodePNGFilterStrategy>(options.filter);
+    }
+    if (options.threads > 1) {
+        zlib.custom_zlib = parallelZlibCompress;
+        zlib.custom_context = &options.threads;
+    }
+}
+
+// Copies the rows of a 1, 2, 4 or 8 bpp Pix into the raw layout lodepng
+// expects: MSB-first bytes with no padding bits between rows. Optionally
+// inverts the bits, as 1 bpp Pix use 1 for black.
+void packRows(Pix *pix, bool invert, std::vector<unsigned char> &out)
+{
+    const int rowBits = pix->w * pix->d;
+    const int rowBytes = (rowBits + 7) / 8;
+    const int tailBits = rowBits & 7;
+    const unsigned char mask = invert ? 0xff : 0x00;
+    out.assign((static_cast<size_t>(rowBits) * pix->h + 7) / 8, 0);
+    unsigned char *dst = out.data();
+    const uint32_t *line = pix->data;
+    size_t bit = 0;
+    for (uint32_t y = 0; y < pix->h; ++y) {
+        if (tailBits == 0) {
+            // Rows stay byte aligned.
+            for (int i = 0; i < rowBytes; ++i) {
+                *dst++ = GET_DATA_BYTE(line, i) ^ mask;
+            }
+        } else {
+            // Rows start mid-byte; the last byte of a row is partial.
+            const int shift = bit & 7;
+            unsigned char *row = out.data() + bit / 8;
+            for (int i = 0; i < rowBytes; ++i) {
+                unsigned char value = GET_DATA_BYTE(line, i) ^ mask;
+                if (i == rowBytes - 1) {
+                    value &= 0xff << (8 - tailBits);
+                }
+                row[i] |= value >> shift;
+                if (shift && ((value << (8 - shift)) & 0xff)) {
+                    row[i + 1] |= value << (8 - shift);
+                }
+            }
+            bit += rowBits;
+        }
+        line += pix->wpl;
+    }
+}
+
+// A malloc()ed encoder output, handed to a Node Buffer without copying.
+struct EncodedData
+{
+    EncodedData() : data(NULL), size(0), capacity(0) {}
+    ~EncodedData() { free(data); }
+
+    bool Reserve(size_t length)
+    {
+        if (length > capacity) {
+            unsigned char *grown = static_cast<unsigned char *>(realloc(data, length));
+            if (!grown) {
+                return false;
+            }
+            data = grown;
+            capacity = length;
+        }
+        return true;
+    }
+
+    bool Append(const void *bytes, size_t length)
+    {
+        if (size + length > capacity && !Reserve(std::max(size + length, capacity * 2))) {
+            return false;
+        }
+        memcpy(data + size, bytes, length);
+        size += length;
+        return true;
+    }
+
+    Local<Object> ToBuffer()
+    {
+        if (size > 0 && size < capacity) {
+            unsigned char *trimmed = static_cast<unsigned char *>(realloc(data, size));
+            data = trimmed ? trimmed : data;
+        }
+        char *owned = reinterpret_cast<char *>(data);
+        data = NULL;
+        return Nan::NewBuffer(owned, static_cast<uint32_t>(size)).ToLocalChecked();
+    }
+
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+};
+
+class EncodedStream : public jpge::output_stream
+{
+public:
+    EncodedStream(EncodedData &out) : out_(out) {}
+
+    bool put_buf(const void *buf, int len)
+    {
+        return out_.Append(buf, len);
+    }
+
+private:
+    EncodedData &out_;
+};
+
+// Compresses pix into a JPG one scan line at a time, without unpacking the
+// whole image first.
+bool encodeJpg(Pix *pix, const jpge::params &params, EncodedData &out)
+{
+    Pix *source;
+    if (pix->colormap) {
+        source = pixConvertTo32(pix);
+    } else if (pix->d < 8) {
+        source = pixConvertTo8(pix, 0);
+    } else {
+        source = pixClone(pix);
+    }
+    if (!source) {
+        return false;
+    }
+    const int comps = source->d == 8 ? 1 : 3;
+    std::vector<unsigned char> scanLine(source->w * comps);
+    EncodedStream stream(out);
+    jpge::jpeg_encoder encoder;
+    // Start from a typical compression ratio; the buffer grows as needed.
+    bool ok = out.Reserve(source->w * source->h * comps / 8 + 1024)
+              && encoder.init(&stream, source->w, source->h, comps, params);
+    for (jpge::uint pass = 0; ok && pass < encoder.get_total_passes(); ++pass) {
+        const uint32_t *line = source->data;
+        for (uint32_t y = 0; ok && y < source->h; ++y) {
+            if (comps == 1) {
+                for (uint32_t x = 0; x < source->w; ++x) {
+                    scanLine[x] = GET_DATA_BYTE(line, x);
+                }
+            } else {
+                for (uint32_t x = 0; x < source->w; ++x) {
+                    int32_t rval, gval, bval;
+                    extractRGBValues(line[x], &rval, &gval, &bval);
+                    scanLine[3 * x + 0] = rval;
+                    scanLine[3 * x + 1] = gval;
+                    scanLine[3 * x + 2] = bval;
+                }
+            }
+            ok = encoder.process_scanline(scanLine.data());
+            line += source->wpl;
+        }
+        ok = ok && encoder.process_scanline(NULL);
+    }
+    pixDestroy(&source);
+    return ok;
+}
+
+// Encodes pix as raw pixels, PNG or JPG (quality < 0 selects the default).
+// Does not touch V8, so it is safe to call from worker threads.
+bool encodeImage(Pix *pix, ImageFormat format, const EncodeOptions &options,
+                 EncodedData &out, std::string &error)
+{
+    if (pix->d != 32 && pix->d != 24 && pix->d > 8) {
+        error = "invalid PIX depth";
+        return false;
+    }
+    if (format == FORMAT_JPG) {
+        jpge::params params;
+        if (options.quality >= 0) {
+            params.m_quality = options.quality;
+        }
+        if (!encodeJpg(pix, params, out)) {
+            error = "error while encoding jpg";
+            return false;
+        }
+        return true;
+    }
+    std::vector<unsigned char> imgData;
+    unsigned pngError = 0;
+    if (pix->d == 32 || pix->d == 24) {
+        // Image is RGB, so create a 3 byte per pixel image.
+        uint32_t *line;
+        imgData.reserve(pix->w * pix->h * 3);
+        line = pix->data;
+        for (uint32_t y = 0; y < pix->h; ++y) {
+            for (uint32_t x = 0; x < pix->w; ++x) {
+                int32_t rval, gval, bval;
+                extractRGBValues(line[x], &rval, &gval, &bval);
+                imgData.push_back(rval);
+                imgData.push_back(gval);
+                imgData.push_back(bval);
+            }
+            line += pix->wpl;
+        }
+        if (format == FORMAT_PNG) {
+            lodepng::State state;
+            state.info_png.color.colortype = LCT_RGB;
+            state.info_png.color.bitdepth = 8;
+            state.info_raw.colortype = LCT_RGB;
+            applyPngOptions(state, options);
+            pngError = lodepng_encode(&out.data, &out.size, &imgData[0], pix->w, pix->h, &state);
+        }
+    } else if (format == FORMAT_PNG) {
+        // Rows are passed at their own bit depth, without expanding to 8 bit.
+        packRows(pix, pix->d == 1 && !pix->colormap, imgData);
+        lodepng::State state;
+        if (pix->colormap) {
+            state.info_png.color.colortype = LCT_PALETTE;
+            state.info_png.color.bitdepth = pix->d;
+            state.info_png.color.palettesize = pixcmapGetCount(pix->colormap);
+            state.info_png.color.palette = new unsigned char[1024];
+            state.info_raw.palettesize = pixcmapGetCount(pix->colormap);
+            state.info_raw.palette = new unsigned char[1024];
+            for (size_t i = 0; i < state.info_png.color.palettesize * 4; i += 4) {
+                int32_t r, g, b;
+                pixcmapGetColor(pix->colormap, static_cast<l_int32>(i / 4), &r, &g, &b);
+                state.info_png.color.palette[i+0] = r;
+                state.info_png.color.palette[i+1] = g;
+                state.info_png.color.palette[i+2] = b;
+                state.info_png.color.palette[i+3] = 255;
+                state.info_raw.palette[i+0] = r;
+                state.info_raw.palette[i+1] = g;
+                state.info_raw.palette[i+2] = b;
+                state.info_raw.palette[i+3] = 255;
+            }
+            state.info_raw.colortype = LCT_PALETTE;
+        } else {
+            state.info_png.color.colortype = LCT_GREY;
+            state.info_png.color.bitdepth = pix->d;
+            state.info_raw.colortype = LCT_GREY;
+        }
+        state.info_raw.bitdepth = pix->d;
+        if (pix->d < 8 || pix->colormap) {
+            // Already the smallest mode; skip scanning for another.
+            state.encoder.auto_convert = false;
+        }
+        applyPngOptions(state, options);
+        pngError = lodepng_encode(&out.data, &out.size, &imgData[0], pix->w, pix->h, &state);
+    } else {
+        PIX *pix8 = pixConvertTo8(pix, pix->colormap ? 1 : 0);
+        // Image is Grayscale, so create a 1 byte per pixel image.
+        uint32_t *line;
+        imgData.reserve(pix8->w * pix8->h);
+        line = pix8->data;
+        for (uint32_t y = 0; y < pix8->h; ++y) {
+            for (uint32_t x = 0; x < pix8->w; ++x) {
+                imgData.push_back(GET_DATA_BYTE(line, x));
+            }
+            line += pix8->wpl;
+        }
+        pixDestroy(&pix8);
+    }
+    if (pngError) {
+        std::stringstream msg;
+        msg << "error while encoding '" << lodepng_error_text(pngError) << "'";
+        error = msg.str();
+        return false;
+    }
+    if (format == FORMAT_RAW && !out.Append(imgData.data(), imgData.size())) {
+        error = "out of memory";
+        return false;
+    }
+    return true;
+}
+
+class DecodeWorker : public Nan::AsyncWorker
+{
+public:
+    DecodeWorker(Local<Object> buffer, ImageFormat format, const DecodeOptions &options,
+                 Nan::Callback *callback)
+        : Nan::AsyncWorker(callback), format_(format), options_(options), pix_(NULL)
+    {
+        // Keep the source Buffer alive until decoding has finished.
+        SaveToPersistent("buffer", buffer);
+        data_ = reinterpret_cast<const unsigned char*>(node::Buffer::Data(buffer));
+        length_ = node::Buffer::Length(buffer);
+    }
+
+    ~DecodeWorker()
+    {
+        pixDestroy(&pix_);
+    }
+
+    void Execute()
+    {
+        std::string error;
+        pix_ = decodeImage(format_, data_, length_, options_, error);
+        if (!pix_) {
+            SetErrorMessage(error.c_str());
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { Nan::Null(), Image::New(pix_) };
+        pix_ = NULL;
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    ImageFormat format_;
+    DecodeOptions options_;
+    const unsigned char *data_;
+    size_t length_;
+    Pix *pix_;
+};
+
+class EncodeWorker : public Nan::AsyncWorker
+{
+public:
+    EncodeWorker(Local<Object> image, ImageFormat format, const EncodeOptions &options,
+                 Nan::Callback *callback)
+        : Nan::AsyncWorker(callback), format_(format), options_(options)
+    {
+        SaveToPersistent("image", image);
+        pix_ = Image::Share(Image::Pixels(image));
+    }
+
+    ~EncodeWorker()
+    {
+        pixDestroy(&pix_);
+    }
+
+    void Execute()
+    {
+        std::string error;
+        if (!encodeImage(pix_, format_, options_, data_, error)) {
+            SetErrorMessage(error.c_str());
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = {
+            Nan::Null(),
+            data_.ToBuffer()
+        };
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    ImageFormat format_;
+    EncodeOptions options_;
+    Pix *pix_;
+    EncodedData data_;
+};
+
+// Strips a trailing {inPlace: Boolean} options object from the arguments.
+static bool toInPlace(Nan::NAN_METHOD_ARGS_TYPE info, int *argc)
+{
+    *argc = info.Length();
+    if (*argc == 0 || !info[*argc - 1]->IsObject() || info[*argc - 1]->IsFunction()
+            || Image::HasInstance(info[*argc - 1])) {
+        return false;
+    }
+    Local<Object> options = info[*argc - 1]->ToObject();
+    --*argc;
+    return Nan::Get(options, Nan::New("inPlace").ToLocalChecked()).ToLocalChecked()->BooleanValue();
+}
+
+// Applies an op of the form op(pixd, pixs1, pixs2), in place on pixs1 if
+// requested. Leptonica rejects aliased operands, so those are copied first.
+static Pix *applyOp(Pix *(*op)(Pix*, Pix*, Pix*), Pix *pixs1, Pix *pixs2, bool inPlace)
+{
+    Pix *copy = NULL;
+    if (pixs1 == pixs2) {
+        pixs2 = copy = pixCopy(NULL, pixs2);
+    }
+    Pix *pixd = op(inPlace ? pixs1 : NULL, pixs1, pixs2);
+    pixDestroy(&copy);
+    return pixd;
+}
+
 bool Image::HasInstance(Handle<Value> val)
 {
     if (!val->IsObject()) {
         return false;
     }
-    return Nan::New(constructor_template)->HasInstance(val->ToObject());
+    Local<FunctionTemplate> ctor = constructor_template.Get(Isolate::GetCurrent());
+    return !ctor.IsEmpty() && ctor->HasInstance(val->ToObject())
+            && Nan::ObjectWrap::Unwrap<Image>(val->ToObject())->pix_ != NULL;
 }
 
 Pix *Image::Pixels(Local<Object> obj)
@@ -187,6 +829,11 @@ Pix *Image::Pixels(Local<Object> obj)
     return Nan::ObjectWrap::Unwrap<Image>(obj)->pix_;
 }
 
+Pix *Image::Share(Pix *pix)
+{
+    return isWrapped(pix) ? pixCopy(NULL, pix) : pixClone(pix);
+}
+
 NAN_MODULE_INIT(Image::Init)
 {  
     auto ctor = Nan::New<v8::FunctionTemplate>(New);
@@ -240,8 +887,13 @@ NAN_MODULE_INIT(Image::Init)
     Nan::SetPrototypeMethod(ctor, "drawImage", DrawImage);
     Nan::SetPrototypeMethod(ctor, "drawLine", DrawLine);
     Nan::SetPrototypeMethod(ctor, "toBuffer", ToBuffer);
+    Nan::SetPrototypeMethod(ctor, "toBufferAsync", ToBufferAsync);
+    Nan::SetPrototypeMethod(ctor, "pipeline", Pipeline);
+    Nan::SetPrototypeMethod(ctor, "pixels", PixelData);
+    Nan::SetPrototypeMethod(ctor, "dispose", Dispose);
+    Nan::SetMethod(ctor, "decode", Decode);
     
-    constructor_template.Reset(ctor);
+    constructor_template.Set(Isolate::GetCurrent(), ctor);
 
     Nan::Set(target, Nan::New("Image").ToLocalChecked(), Nan::GetFunction(ctor).ToLocalChecked());
 }
@@ -249,12 +901,19 @@ NAN_MODULE_INIT(Image::Init)
 Local<Object> Image::New(Pix *pix, int resolution)
 {
     Nan::EscapableHandleScope scope;
-    Local<Object> instance = Nan::NewInstance(Nan::New(constructor_template)->GetFunction()).ToLocalChecked();
+    Local<FunctionTemplate> ctor = constructor_template.Get(Isolate::GetCurrent());
+    Local<Object> instance = Nan::NewInstance(Nan::GetFunction(ctor).ToLocalChecked()).ToLocalChecked();
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(instance);
+    if (pix && isWrapped(pix)) {
+        // A clone of borrowed data must not outlive its Buffer.
+        Pix *copy = pixCopy(NULL, pix);
+        pixDestroy(&pix);
+        pix = copy;
+    }
     obj->pix_ = pix;
     if (obj->pix_) {
         pixSetYRes(obj->pix_, resolution);
-        Nan::AdjustExternalMemory(obj->size());
+        obj->Account();
     }
     return scope.Escape(instance);
 }
@@ -275,43 +934,27 @@ NAN_METHOD(Image::New)
         pix = 0;
     } else if (info.Length() == 1 && Image::HasInstance(info[0])) {
         pix = pixCopy(NULL, Image::Pixels(info[0]->ToObject()));
-    } else if (info.Length() == 2 && node::Buffer::HasInstance(info[1])) {
+    } else if ((info.Length() == 2 || (info.Length() == 3 && info[0]->IsString() && info[2]->IsObject()))
+               && node::Buffer::HasInstance(info[1])) {
         String::Utf8Value format(info[0]->ToString());
-        Local<Object> buffer = info[1]->ToObject();
-        unsigned char *in = reinterpret_cast<unsigned char*>(node::Buffer::Data(buffer));
-        size_t inLength = node::Buffer::Length(buffer);
-        if (strcmp("png", *format) == 0) {
-            std::vector<unsigned char> out;
-            unsigned int width;
-            unsigned int height;
-            lodepng::State state;
-            unsigned error = lodepng::decode(out, width, height, state, in, inLength);
-            if (error) {
-                std::stringstream msg;
-                msg << "error while decoding '" << lodepng_error_text(error) << "'";
-                return Nan::ThrowError(msg.str().c_str());
-            }
-            if (state.info_png.color.colortype == LCT_GREY || state.info_png.color.colortype == LCT_GREY_ALPHA) {
-                pix = pixFromSource(&out[0], width, height, 32, 8);
-            } else {
-                pix = pixFromSource(&out[0], width, height, 32, 32);
-            }
-        } else if (strcmp("jpg", *format) == 0) {
-            int width;
-            int height;
-            int comps;
-            unsigned char *out = jpgd::decompress_jpeg_image_from_memory(
-                        in, static_cast<int>(inLength), &width, &height, &comps, 4);
-            if (!out) {
-                return Nan::ThrowError("error while decoding jpg");
-            }
-            pix = pixFromSource(out, width, height, 32, comps == 1 ? 8 : 32);
-            free(out);
-        } else {
+        ImageFormat formatEnum = toImageFormat(*format);
+        if (formatEnum != FORMAT_PNG && formatEnum != FORMAT_JPG) {
             std::stringstream msg;
             msg << "invalid bufffer format '" << *format << "'";
             return Nan::ThrowError(msg.str().c_str());
         }
+        Local<Object> buffer = info[1]->ToObject();
+        unsigned char *in = reinterpret_cast<unsigned char*>(node::Buffer::Data(buffer));
+        size_t inLength = node::Buffer::Length(buffer);
+        DecodeOptions options;
+        if (info.Length() == 3 && !toDecodeOptions(info[2], &options)) {
+            return Nan::ThrowTypeError("scale must be 1, 1/2, 1/4 or 1/8");
+        }
+        std::string error;
+        pix = decodeImage(formatEnum, in, inLength, options, error);
+        if (!pix) {
+            return Nan::ThrowError(error.c_str());
+        }
     } else if (info.Length() == 3 && info[0]->IsNumber() && info[1]->IsNumber()
                && info[2]->IsNumber()) {
         int32_t width = info[0]->Int32Value();
@@ -325,7 +968,8 @@ NAN_METHOD(Image::New)
         pix = pixCompose(Image::Pixels(info[0]->ToObject()),
                 Image::Pixels(info[1]->ToObject()),
                 Image::Pixels(info[2]->ToObject()));
-    } else if (info.Length() == 4 && node::Buffer::HasInstance(info[1])) {
+    } else if ((info.Length() == 4 || (info.Length() == 5 && info[4]->IsObject()))
+               && node::Buffer::HasInstance(info[1])) {
         String::Utf8Value format(info[0]->ToString());
         Local<Object> buffer = info[1]->ToObject();
         size_t length = node::Buffer::Length(buffer);
@@ -345,15 +989,70 @@ NAN_METHOD(Image::New)
             msg << "invalid buffer format '" << *format << "'";
             return Nan::ThrowError(msg.str().c_str());
         }
+        bool wrap = false;
+        int32_t stride = width * depth / 8;
+        // Plain rgba and gray bytes read as big-endian words.
+        const char *byteOrder = "BE";
+        if (info.Length() == 5) {
+            Local<Object> options = info[4]->ToObject();
+            wrap = Nan::Get(options, Nan::New("wrap").ToLocalChecked()).ToLocalChecked()->BooleanValue();
+            Local<Value> strideValue = Nan::Get(options, Nan::New("stride").ToLocalChecked()).ToLocalChecked();
+            if (!strideValue->IsUndefined()) {
+                if (!wrap || !strideValue->IsInt32() || strideValue->Int32Value() < stride) {
+                    return Nan::ThrowTypeError("stride must be an Int32 of at least one row and requires wrap");
+                }
+                stride = strideValue->Int32Value();
+            }
+            Local<Value> byteOrderValue = Nan::Get(options, Nan::New("byteOrder").ToLocalChecked()).ToLocalChecked();
+            if (!byteOrderValue->IsUndefined()) {
+                const char *error = "byteOrder must be 'BE' or 'LE' and requires wrap";
+                if (!wrap || !byteOrderValue->IsString()) {
+                    return Nan::ThrowTypeError(error);
+                }
+                String::Utf8Value name(byteOrderValue);
+                if (strcmp("BE", *name) != 0 && strcmp("LE", *name) != 0) {
+                    return Nan::ThrowTypeError(error);
+                }
+                byteOrder = strcmp("LE", *name) == 0 ? "LE" : "BE";
+            }
+        }
+        uint8_t *data = reinterpret_cast<uint8_t*>(node::Buffer::Data(buffer));
+        if (wrap) {
+            // Share the Buffer as Pix data, which needs whole 32-bit words.
+            if (depth == 24) {
+                return Nan::ThrowError("wrap requires 'rgba' or 'gray' data");
+            }
+            if (stride % 4 != 0 || reinterpret_cast<uintptr_t>(data) % 4 != 0) {
+                return Nan::ThrowError("wrap requires 4-byte aligned data and stride");
+            }
+            if (length < static_cast<size_t>(stride) * height) {
+                return Nan::ThrowError("invalid Buffer length");
+            }
+            // Leptonica reads pixels from host-order words, so other data
+            // would have to be copied or swapped in the caller's Buffer.
+            if (strcmp(byteOrder, hostByteOrder) != 0) {
+                std::stringstream msg;
+                msg << "wrap requires rows of 32-bit words in host byte order (byteOrder: '"
+                    << hostByteOrder << "')";
+                return Nan::ThrowError(msg.str().c_str());
+            }
+            pix = pixWrapSource(data, width, height, targetDepth, stride);
+            if (!pix) {
+                return Nan::ThrowError("error while wrapping Buffer");
+            }
+            Image* obj = new Image(pix, buffer);
+            obj->Wrap(info.This());
+            return;
+        }
         size_t expectedLength = width * height * depth;
         if (expectedLength != length << 3) {
             return Nan::ThrowError("invalid Buffer length");
         }
-        pix = pixFromSource(reinterpret_cast<uint8_t*>(node::Buffer::Data(buffer)), width, height, depth, targetDepth);
+        pix = pixFromSource(data, width, height, depth, targetDepth);
     } else {
         return Nan::ThrowTypeError("expected (image: Image) or (image1: Image, "
                      "image2: Image, image3: Image) or (format: String, "
-                     "image: Buffer, [width: Int32, height: Int32])");
+                     "image: Buffer, [width: Int32, height: Int32, [options: Object]])");
     }
     Image* obj = new Image(pix);
     
@@ -403,7 +1102,8 @@ NAN_GETTER(Image::GetResolution)
 NAN_SETTER(Image::SetResolution)
 {
     Nan::HandleScope scope;
-    Image* obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (value->IsInt32()) {
         pixSetYRes(obj->pix_, value->Int32Value());
     } else if (value->IsNull()) {
@@ -416,23 +1116,31 @@ NAN_SETTER(Image::SetResolution)
 NAN_METHOD(Image::Invert)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
-    Pix *pixd = pixInvert(NULL, obj->pix_);
+    CheckDisposed(obj);
+    int argc;
+    bool inPlace = toInPlace(info, &argc);
+    Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+    Pix *pixd = pixInvert(inPlace ? pixs : NULL, pixs);
     if (pixd == NULL) {
         return Nan::ThrowTypeError("error while applying INVERT");
     }
-    info.GetReturnValue().Set(Image::New(pixd));
+    info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
 }
 
 NAN_METHOD(Image::Or)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (Image::HasInstance(info[0])) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         Pix *otherPix = Image::Pixels(info[0]->ToObject());
-        Pix *pixd = pixOr(NULL, obj->pix_, otherPix);
+        Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+        Pix *pixd = applyOp(pixOr, pixs, otherPix, inPlace);
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while applying OR");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (image: Image)");
     }
@@ -441,13 +1149,17 @@ NAN_METHOD(Image::Or)
 NAN_METHOD(Image::And)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (Image::HasInstance(info[0])) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         Pix *otherPix = Image::Pixels(info[0]->ToObject());
-        Pix *pixd = pixAnd(NULL, obj->pix_, otherPix);
+        Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+        Pix *pixd = applyOp(pixAnd, pixs, otherPix, inPlace);
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while applying AND");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (image: Image)");
     }
@@ -456,13 +1168,17 @@ NAN_METHOD(Image::And)
 NAN_METHOD(Image::Xor)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (Image::HasInstance(info[0])) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         Pix *otherPix = Image::Pixels(info[0]->ToObject());
-        Pix *pixd = pixXor(NULL, obj->pix_, otherPix);
+        Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+        Pix *pixd = applyOp(pixXor, pixs, otherPix, inPlace);
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while applying XOR");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (image: Image)");
     }
@@ -471,26 +1187,25 @@ NAN_METHOD(Image::Xor)
 NAN_METHOD(Image::Add)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (Image::HasInstance(info[0])) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         Pix *otherPix = Image::Pixels(info[0]->ToObject());
         Pix *pixd;
         if (obj->pix_->d == 32) {
             pixd = pixAddRGB(obj->pix_, otherPix);
         } else if (obj->pix_->d >= 8) {
-            if (obj->pix_ == otherPix) {
-                otherPix = pixCopy(NULL, otherPix);
-                pixd = pixAddGray(NULL, obj->pix_, otherPix);
-                pixDestroy(&otherPix);
-            } else {
-                pixd = pixAddGray(NULL, obj->pix_, otherPix);
-            }
+            Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+            pixd = applyOp(pixAddGray, pixs, otherPix, inPlace);
         } else {
-            pixd = pixOr(NULL, obj->pix_, otherPix);
+            Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+            pixd = applyOp(pixOr, pixs, otherPix, inPlace);
         }
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while applying ADD");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (image: Image)");
     }
@@ -499,24 +1214,22 @@ NAN_METHOD(Image::Add)
 NAN_METHOD(Image::Subtract)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (Image::HasInstance(info[0])) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         Pix *otherPix = Image::Pixels(info[0]->ToObject());
+        Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
         Pix *pixd;
-        if(obj->pix_->d >= 8) {
-            if (obj->pix_ == otherPix) {
-                otherPix = pixCopy(NULL, otherPix);
-                pixd = pixSubtractGray(NULL, obj->pix_, otherPix);
-                pixDestroy(&otherPix);
-            } else {
-                pixd = pixSubtractGray(NULL, obj->pix_, otherPix);
-            }
+        if(pixs->d >= 8) {
+            pixd = applyOp(pixSubtractGray, pixs, otherPix, inPlace);
         } else {
-            pixd = pixSubtract(NULL, obj->pix_, otherPix);
+            pixd = applyOp(pixSubtract, pixs, otherPix, inPlace);
         }
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while applying SUBTRACT");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (image: Image)");
     }
@@ -525,7 +1238,10 @@ NAN_METHOD(Image::Subtract)
 NAN_METHOD(Image::Convolve)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber()) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         int width = static_cast<int>(ceil(info[0]->NumberValue()));
         int height = static_cast<int>(ceil(info[1]->NumberValue()));
         Pix *pixs;
@@ -539,7 +1255,7 @@ NAN_METHOD(Image::Convolve)
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while applying convolve");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (width: Number, height: Number)");
     }
@@ -548,6 +1264,7 @@ NAN_METHOD(Image::Convolve)
 NAN_METHOD(Image::Unsharp)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber()) {
         int halfWidth = static_cast<int>(ceil(info[0]->NumberValue()));
         float fract = static_cast<float>(info[1]->NumberValue());
@@ -564,6 +1281,7 @@ NAN_METHOD(Image::Unsharp)
 NAN_METHOD(Image::Rotate)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsNumber()) {
         const float deg2rad = 3.1415926535f / 180.0f;
         float angle = static_cast<float>(info[0]->NumberValue());
@@ -582,6 +1300,7 @@ NAN_METHOD(Image::Rotate)
 NAN_METHOD(Image::Scale)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && (info.Length() != 2 || info[1]->IsNumber())) {
         float scaleX = static_cast<float>(info[0]->NumberValue());
         float scaleY = static_cast<float>(info.Length() == 2 ? info[1]->NumberValue() : scaleX);
@@ -597,8 +1316,9 @@ NAN_METHOD(Image::Scale)
 
 NAN_METHOD(Image::Crop)
 {
-    Box* box = toBox(info, 0);
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
+    Box* box = toBox(info, 0);
     if (box) {
         PIX *pixd = pixClipRectangle(obj->pix_, box, 0);
         boxDestroy(&box);
@@ -614,6 +1334,7 @@ NAN_METHOD(Image::Crop)
 NAN_METHOD(Image::InRange)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber() && info[2]->IsNumber() &&
             info[3]->IsNumber() && info[4]->IsNumber() && info[5]->IsNumber()) {
         int32_t val1l = info[0]->Int32Value();
@@ -638,6 +1359,7 @@ NAN_METHOD(Image::InRange)
 NAN_METHOD(Image::Histogram)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     PIX *mask = NULL;
     if (info.Length() >= 1 && Image::HasInstance(info[0])) {
         mask = Image::Pixels(info[1]->ToObject());
@@ -662,6 +1384,7 @@ NAN_METHOD(Image::Histogram)
 NAN_METHOD(Image::Projection)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsString()) {
         String::Utf8Value mode(info[0]->ToString());
         ProjectionMode modeEnum;
@@ -693,10 +1416,11 @@ NAN_METHOD(Image::Projection)
 NAN_METHOD(Image::SetMasked)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (Image::HasInstance(info[0]) && info[1]->IsNumber()) {
         Pix *mask = Image::Pixels(info[0]->ToObject());
         int value = info[1]->Int32Value();
-        if (pixSetMasked(obj->pix_, mask, value) == 1) {
+        if (pixSetMasked(obj->Writable(), mask, value) == 1) {
             return Nan::ThrowTypeError("error while applying mask");
         }
         info.GetReturnValue().Set(info.This());
@@ -708,6 +1432,7 @@ NAN_METHOD(Image::SetMasked)
 NAN_METHOD(Image::ApplyCurve)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsArray() &&
             info[0]->ToObject()->Get(Nan::New("length").ToLocalChecked())->Uint32Value() == 256) {
         NUMA *numa = numaCreate(256);
@@ -718,7 +1443,7 @@ NAN_METHOD(Image::ApplyCurve)
         if (info.Length() >= 2 && Image::HasInstance(info[1])) {
             mask = Image::Pixels(info[1]->ToObject());
         }
-        int result = pixTRCMap(obj->pix_, mask, numa);
+        int result = pixTRCMap(obj->Writable(), mask, numa);
         if (result != 0) {
             return Nan::ThrowTypeError("error while applying value mapping");
         }
@@ -731,6 +1456,7 @@ NAN_METHOD(Image::ApplyCurve)
 NAN_METHOD(Image::RankFilter)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber() && info[2]->IsNumber()) {
         int width = static_cast<int>(ceil(info[0]->NumberValue()));
         int height = static_cast<int>(ceil(info[1]->NumberValue()));
@@ -748,6 +1474,7 @@ NAN_METHOD(Image::RankFilter)
 NAN_METHOD(Image::OctreeColorQuant)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsInt32()) {
         int colors = info[0]->Int32Value();
         PIX *pixd = pixOctreeColorQuant(obj->pix_, colors, 0);
@@ -763,6 +1490,7 @@ NAN_METHOD(Image::OctreeColorQuant)
 NAN_METHOD(Image::MedianCutQuant)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info[0]->IsInt32()) {
         int colors = info[0]->Int32Value();
         PIX *pixd = pixMedianCutQuantGeneral(obj->pix_, 0, 0, colors, 0, 1, 1);
@@ -778,13 +1506,16 @@ NAN_METHOD(Image::MedianCutQuant)
 NAN_METHOD(Image::Threshold)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
-    if (info.Length() == 0 || info[0]->IsInt32()) {
-        int value = info.Length() == 0 ? 128 : info[0]->Int32Value();
+    CheckDisposed(obj);
+    int argc;
+    bool inPlace = toInPlace(info, &argc);
+    if (argc == 0 || info[0]->IsInt32()) {
+        int value = argc == 0 ? 128 : info[0]->Int32Value();
         PIX *pixd = pixConvertTo1(obj->pix_, value);
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while thresholding");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (value: Int32)");
     }
@@ -793,6 +1524,7 @@ NAN_METHOD(Image::Threshold)
 NAN_METHOD(Image::ToGray)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (obj->pix_->d == 8) {
         info.GetReturnValue().Set(Image::New(pixClone(obj->pix_)));
         return;
@@ -843,12 +1575,14 @@ NAN_METHOD(Image::ToGray)
 NAN_METHOD(Image::ToColor)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     info.GetReturnValue().Set(Image::New(pixConvertTo32(obj->pix_)));
 }
 
 NAN_METHOD(Image::ToHSV)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     PIX *pixd = pixConvertRGBToHSV(NULL, obj->pix_);
     if (pixd != NULL) {
         info.GetReturnValue().Set(Image::New(pixd));
@@ -860,6 +1594,7 @@ NAN_METHOD(Image::ToHSV)
 NAN_METHOD(Image::ToRGB)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     PIX *pixd = pixConvertHSVToRGB(NULL, obj->pix_);
     if (pixd != NULL) {
         info.GetReturnValue().Set(Image::New(pixd));
@@ -871,19 +1606,23 @@ NAN_METHOD(Image::ToRGB)
 NAN_METHOD(Image::Erode)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber()) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         int width = static_cast<int>(ceil(info[0]->NumberValue()));
         int height = static_cast<int>(ceil(info[1]->NumberValue()));
         PIX *pixd = 0;
         if (obj->pix_->d == 1) {
-            pixd = pixErodeBrick(NULL, obj->pix_, width, height);
+            Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+            pixd = pixErodeBrick(inPlace ? pixs : NULL, pixs, width, height);
         } else {
             pixd = pixErodeGray(obj->pix_, width, height);
         }
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while eroding");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (width: Number, height: Number)");
     }
@@ -892,19 +1631,23 @@ NAN_METHOD(Image::Erode)
 NAN_METHOD(Image::Dilate)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber()) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         int width = static_cast<int>(ceil(info[0]->NumberValue()));
         int height = static_cast<int>(ceil(info[1]->NumberValue()));
         PIX *pixd = 0;
         if (obj->pix_->d == 1) {
-            pixd = pixDilateBrick(NULL, obj->pix_, width, height);
+            Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+            pixd = pixDilateBrick(inPlace ? pixs : NULL, pixs, width, height);
         } else {
             pixd = pixDilateGray(obj->pix_, width, height);
         }
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while dilating");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (width: Number, height: Number)");
     }
@@ -913,19 +1656,23 @@ NAN_METHOD(Image::Dilate)
 NAN_METHOD(Image::Open)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber()) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         int width = static_cast<int>(ceil(info[0]->NumberValue()));
         int height = static_cast<int>(ceil(info[1]->NumberValue()));
         PIX *pixd = 0;
         if (obj->pix_->d == 1) {
-            pixd = pixOpenBrick(NULL, obj->pix_, width, height);
+            Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+            pixd = pixOpenBrick(inPlace ? pixs : NULL, pixs, width, height);
         } else {
             pixd = pixOpenGray(obj->pix_, width, height);
         }
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while opening");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (width: Number, height: Number)");
     }
@@ -934,19 +1681,23 @@ NAN_METHOD(Image::Open)
 NAN_METHOD(Image::Close)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsNumber() && info[1]->IsNumber()) {
+        int argc;
+        bool inPlace = toInPlace(info, &argc);
         int width = static_cast<int>(ceil(info[0]->NumberValue()));
         int height = static_cast<int>(ceil(info[1]->NumberValue()));
         PIX *pixd = 0;
         if (obj->pix_->d == 1) {
-            pixd = pixCloseBrick(NULL, obj->pix_, width, height);
+            Pix *pixs = inPlace ? obj->Writable() : obj->pix_;
+            pixd = pixCloseBrick(inPlace ? pixs : NULL, pixs, width, height);
         } else {
             pixd = pixCloseGray(obj->pix_, width, height);
         }
         if (pixd == NULL) {
             return Nan::ThrowTypeError("error while closing");
         }
-        info.GetReturnValue().Set(Image::New(pixd));
+        info.GetReturnValue().Set(obj->Output(pixd, inPlace, info.This()));
     } else {
         return Nan::ThrowTypeError("expected (width: Number, height: Number)");
     }
@@ -955,6 +1706,7 @@ NAN_METHOD(Image::Close)
 NAN_METHOD(Image::Thin)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsString() && info[1]->IsInt32() && info[2]->IsInt32()) {
         int typeInt = 0;
         String::Utf8Value type(info[0]->ToString());
@@ -986,6 +1738,7 @@ NAN_METHOD(Image::Thin)
 NAN_METHOD(Image::MaxDynamicRange)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsString()) {
         int typeInt = 0;
         String::Utf8Value type(info[0]->ToString());
@@ -1007,6 +1760,7 @@ NAN_METHOD(Image::MaxDynamicRange)
 NAN_METHOD(Image::OtsuAdaptiveThreshold)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsInt32() && info[1]->IsInt32()
             && info[2]->IsInt32() && info[3]->IsInt32()
             && info[4]->IsNumber()) {
@@ -1038,6 +1792,7 @@ NAN_METHOD(Image::OtsuAdaptiveThreshold)
 NAN_METHOD(Image::LineSegments)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsInt32() && info[1]->IsInt32()) {
         if (obj->pix_->d != 8) {
             return Nan::ThrowTypeError("Not a 8bpp Image");
@@ -1089,6 +1844,7 @@ NAN_METHOD(Image::LineSegments)
 NAN_METHOD(Image::FindSkew)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     int32_t depth = pixGetDepth(obj->pix_);
     if (depth != 1) {
         return Nan::ThrowTypeError("expected binarized image");
@@ -1109,6 +1865,7 @@ NAN_METHOD(Image::FindSkew)
 NAN_METHOD(Image::ConnectedComponents)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsInt32()) {
         int connectivity = info[0]->Int32Value();
         PIX *pix = obj->pix_;
@@ -1137,6 +1894,7 @@ NAN_METHOD(Image::ConnectedComponents)
 NAN_METHOD(Image::DistanceFunction)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     if (info[0]->IsInt32()) {
         int connectivity = info[0]->Int32Value();
         PIX *pix = obj->pix_;
@@ -1161,13 +1919,14 @@ NAN_METHOD(Image::DistanceFunction)
 NAN_METHOD(Image::ClearBox)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     Box* box = toBox(info, 0);
     if (box) {
         int error;
         if (obj->pix_->d == 1) {
-            error = pixClearInRect(obj->pix_, box);
+            error = pixClearInRect(obj->Writable(), box);
         } else {
-            error = pixSetInRect(obj->pix_, box);
+            error = pixSetInRect(obj->Writable(), box);
         }
         boxDestroy(&box);
         if (error) {
@@ -1182,6 +1941,7 @@ NAN_METHOD(Image::ClearBox)
 NAN_METHOD(Image::FillBox)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     int boxEnd;
     BOX *box = toBox(info, 0, &boxEnd);
     if (box) {
@@ -1192,7 +1952,7 @@ NAN_METHOD(Image::FillBox)
                 return Nan::ThrowTypeError("Not a 8bpp or 1bpp Image");
             }
             int value = info[boxEnd + 1]->Int32Value();
-            error = pixSetInRectArbitrary(obj->pix_, box, value);
+            error = pixSetInRectArbitrary(obj->Writable(), box, value);
         }
         else if (info[boxEnd + 1]->IsInt32() && info[boxEnd + 2]->IsInt32()
                  && info[boxEnd + 3]->IsInt32()) {
@@ -1207,10 +1967,10 @@ NAN_METHOD(Image::FillBox)
             composeRGBPixel(r, g, b, &pixel);
             if (info[boxEnd + 4]->IsNumber()) {
                 float fract = static_cast<float>(info[boxEnd + 4]->NumberValue());
-                error = pixBlendInRect(obj->pix_, box, pixel, fract);
+                error = pixBlendInRect(obj->Writable(), box, pixel, fract);
             }
             else {
-                error = pixSetInRectArbitrary(obj->pix_, box, pixel);
+                error = pixSetInRectArbitrary(obj->Writable(), box, pixel);
             }
         }
         else {
@@ -1233,6 +1993,7 @@ NAN_METHOD(Image::FillBox)
 NAN_METHOD(Image::DrawBox)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     int boxEnd;
     BOX *box = toBox(info, 0, &boxEnd);
     if (box && info[boxEnd + 1]->IsInt32()) {
@@ -1244,7 +2005,7 @@ NAN_METHOD(Image::DrawBox)
                 boxDestroy(&box);
                 return Nan::ThrowTypeError("invalid op");
             }
-            error = pixRenderBox(obj->pix_, box, borderWidth, op);
+            error = pixRenderBox(obj->Writable(), box, borderWidth, op);
         } else if (info[boxEnd + 2]->IsInt32() && info[boxEnd + 3]->IsInt32()
                    && info[boxEnd + 4]->IsInt32()) {
             if (obj->pix_->d < 32) {
@@ -1256,9 +2017,9 @@ NAN_METHOD(Image::DrawBox)
             uint8_t b = info[boxEnd + 4]->Int32Value();
             if (info[boxEnd + 5]->IsNumber()) {
                 float fract = static_cast<float>(info[boxEnd + 5]->NumberValue());
-                error = pixRenderBoxBlend(obj->pix_, box, borderWidth, r, g, b, fract);
+                error = pixRenderBoxBlend(obj->Writable(), box, borderWidth, r, g, b, fract);
             } else {
-                error = pixRenderBoxArb(obj->pix_, box, borderWidth, r, g, b);
+                error = pixRenderBoxArb(obj->Writable(), box, borderWidth, r, g, b);
             }
         } else {
             boxDestroy(&box);
@@ -1281,6 +2042,7 @@ NAN_METHOD(Image::DrawBox)
 NAN_METHOD(Image::DrawLine)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     const auto strX = Nan::New("x").ToLocalChecked();
     const auto strY = Nan::New("y").ToLocalChecked();
     
@@ -1298,7 +2060,7 @@ NAN_METHOD(Image::DrawLine)
             if (op == -1) {
                 return Nan::ThrowTypeError("invalid op");
             }
-            error = pixRenderLine(obj->pix_, x1, y1, x2, y2, width, op);
+            error = pixRenderLine(obj->Writable(), x1, y1, x2, y2, width, op);
         } else if (info[3]->IsInt32() && info[4]->IsInt32() && info[5]->IsInt32()) {
             if (obj->pix_->d < 32) {
                 return Nan::ThrowTypeError("Not a 32bpp Image");
@@ -1308,9 +2070,9 @@ NAN_METHOD(Image::DrawLine)
             uint8_t b = info[5]->Int32Value();
             if (info[6]->IsNumber()) {
                 float fract = static_cast<float>(info[6]->NumberValue());
-                error = pixRenderLineBlend(obj->pix_, x1, y1, x2, y2, width, r, g, b, fract);
+                error = pixRenderLineBlend(obj->Writable(), x1, y1, x2, y2, width, r, g, b, fract);
             } else {
-                error = pixRenderLineArb(obj->pix_, x1, y1, x2, y2, width, r, g, b);
+                error = pixRenderLineArb(obj->Writable(), x1, y1, x2, y2, width, r, g, b);
             }
         } else {
              return Nan::ThrowTypeError("expected (p1: Point, p2: Point, "
@@ -1333,11 +2095,12 @@ NAN_METHOD(Image::DrawLine)
 NAN_METHOD(Image::DrawImage)
 {
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    CheckDisposed(obj);
     int boxEnd;
     BOX *box = toBox(info, 1, &boxEnd);
     if (Image::HasInstance(info[0]) && box) {
         PIX *otherPix = Image::Pixels(info[0]->ToObject());
-        int error = pixRasterop(obj->pix_, box->x, box->y, box->w, box->h,
+        int error = pixRasterop(obj->Writable(), box->x, box->y, box->w, box->h,
                                 PIX_SRC, otherPix, 0, 0);
         boxDestroy(&box);
         if (error) {
@@ -1351,184 +2114,237 @@ NAN_METHOD(Image::DrawImage)
 
 NAN_METHOD(Image::ToBuffer)
 {
-    //NanScope();
-    const int FORMAT_RAW = 0;
-    const int FORMAT_PNG = 1;
-    const int FORMAT_JPG = 2;
-    int formatInt = FORMAT_RAW;
-    jpge::params params;
+    ImageFormat format = FORMAT_RAW;
+    EncodeOptions options;
     Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
     if (info.Length() >= 1 && info[0]->IsString()) {
-        String::Utf8Value format(info[0]->ToString());
-        if (strcmp("raw", *format) == 0) {
-            formatInt = FORMAT_RAW;
-        } else if (strcmp("png", *format) == 0) {
-            formatInt = FORMAT_PNG;
-        } else if (strcmp("jpg", *format) == 0) {
-            formatInt = FORMAT_JPG;
-            if (info[1]->IsNumber()) {
-                params.m_quality = info[1]->Int32Value();
-            }
-        } else {
+        String::Utf8Value formatStr(info[0]->ToString());
+        format = toImageFormat(*formatStr);
+        if (format == FORMAT_INVALID) {
             std::stringstream msg;
-            msg << "invalid format '" << *format << "'";
+            msg << "invalid format '" << *formatStr << "'";
             return Nan::ThrowError(msg.str().c_str());
         }
-    }
-    std::vector<unsigned char> imgData;
-    std::vector<unsigned char> pngData;
-    char *jpgData;
-    int jpgDataSize;
-    unsigned error = 0;
-    if (obj->pix_->d == 32 || obj->pix_->d == 24) {
-        // Image is RGB, so create a 3 byte per pixel image.
-        uint32_t *line;
-        imgData.reserve(obj->pix_->w * obj->pix_->h * 3);
-        line = obj->pix_->data;
-        for (uint32_t y = 0; y < obj->pix_->h; ++y) {
-            for (uint32_t x = 0; x < obj->pix_->w; ++x) {
-                int32_t rval, gval, bval;
-                extractRGBValues(line[x], &rval, &gval, &bval);
-                imgData.push_back(rval);
-                imgData.push_back(gval);
-                imgData.push_back(bval);
-            }
-            line += obj->pix_->wpl;
-        }
-        if (formatInt == FORMAT_PNG) {
-            lodepng::State state;
-            state.info_png.color.colortype = LCT_RGB;
-            state.info_png.color.bitdepth = 8;
-            state.info_raw.colortype = LCT_RGB;
-            error = lodepng::encode(pngData, imgData, obj->pix_->w, obj->pix_->h, state);
-        } else if (formatInt == FORMAT_JPG) {
-            jpgDataSize = obj->pix_->w * obj->pix_->h * 3 + 1024;
-            jpgData = (char*)malloc(jpgDataSize);
-            if (!jpge::compress_image_to_jpeg_file_in_memory(
-                        jpgData, jpgDataSize, obj->pix_->w, obj->pix_->h,
-                        3, &imgData[0], params)) {
-                error = 1;
+        if (info.Length() >= 2 && !info[1]->IsUndefined()) {
+            const char *optionsError = toEncodeOptions(info[1], format, &options);
+            if (optionsError) {
+                return Nan::ThrowTypeError(optionsError);
             }
         }
-    } else if (obj->pix_->d <= 8) {
-        PIX *pix8 = pixConvertTo8(obj->pix_, obj->pix_->colormap ? 1 : 0);
-        // Image is Grayscale, so create a 1 byte per pixel image.
-        uint32_t *line;
-        imgData.reserve(pix8->w * pix8->h);
-        line = pix8->data;
-        for (uint32_t y = 0; y < pix8->h; ++y) {
-            for (uint32_t x = 0; x < pix8->w; ++x) {
-                imgData.push_back(GET_DATA_BYTE(line, x));
-            }
-            line += pix8->wpl;
+    }
+    EncodedData data;
+    std::string error;
+    if (!encodeImage(obj->pix_, format, options, data, error)) {
+        return Nan::ThrowError(error.c_str());
+    }
+    info.GetReturnValue().Set(data.ToBuffer());
+}
+
+NAN_METHOD(Image::ToBufferAsync)
+{
+    Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
+    int argc = info.Length() - 1;
+    if (argc >= 1 && info[0]->IsString() && info[argc]->IsFunction()) {
+        String::Utf8Value formatStr(info[0]->ToString());
+        ImageFormat format = toImageFormat(*formatStr);
+        if (format == FORMAT_INVALID) {
+            std::stringstream msg;
+            msg << "invalid format '" << *formatStr << "'";
+            return Nan::ThrowError(msg.str().c_str());
         }
-        if (formatInt == FORMAT_PNG) {
-            lodepng::State state;
-            if (obj->pix_->colormap) {
-                state.info_png.color.colortype = LCT_PALETTE;
-                state.info_png.color.bitdepth = obj->pix_->d;
-                if (obj->pix_->d == 8)
-                    state.encoder.auto_convert = false;
-                state.info_png.color.palettesize = pixcmapGetCount(obj->pix_->colormap);
-                state.info_png.color.palette = new unsigned char[1024];
-                state.info_raw.palettesize = pixcmapGetCount(obj->pix_->colormap);
-                state.info_raw.palette = new unsigned char[1024];
-                for (size_t i = 0; i < state.info_png.color.palettesize * 4; i += 4) {
-                    int32_t r, g, b;
-                    pixcmapGetColor(obj->pix_->colormap, static_cast<l_int32>(i / 4), &r, &g, &b);
-                    state.info_png.color.palette[i+0] = r;
-                    state.info_png.color.palette[i+1] = g;
-                    state.info_png.color.palette[i+2] = b;
-                    state.info_png.color.palette[i+3] = 255;
-                    state.info_raw.palette[i+0] = r;
-                    state.info_raw.palette[i+1] = g;
-                    state.info_raw.palette[i+2] = b;
-                    state.info_raw.palette[i+3] = 255;
-                }
-                state.info_raw.colortype = LCT_PALETTE;
-            } else {
-                state.info_png.color.colortype = LCT_GREY;
-                state.info_png.color.bitdepth = obj->pix_->d;
-                state.info_raw.colortype = LCT_GREY;
-            }
-            error = lodepng::encode(pngData, imgData, pix8->w, pix8->h, state);
-            pixDestroy(&pix8);
-        } else if (formatInt == FORMAT_JPG) {
-            if (obj->pix_->colormap) {
-                PIX* rgbPix = pixConvertTo32(obj->pix_);
-                // Image is RGB, so create a 3 byte per pixel image.
-                imgData.clear();
-                uint32_t *line;
-                imgData.reserve(rgbPix->w * rgbPix->h * 3);
-                line = rgbPix->data;
-                for (uint32_t y = 0; y < rgbPix->h; ++y) {
-                    for (uint32_t x = 0; x < rgbPix->w; ++x) {
-                        int32_t rval, gval, bval;
-                        extractRGBValues(line[x], &rval, &gval, &bval);
-                        imgData.push_back(rval);
-                        imgData.push_back(gval);
-                        imgData.push_back(bval);
-                    }
-                    line += rgbPix->wpl;
-                }
-                pixDestroy(&rgbPix);
-                // To JPG
-                jpgDataSize = obj->pix_->w * obj->pix_->h * 3 + 1024;
-                jpgData = (char*)malloc(jpgDataSize);
-                if (!jpge::compress_image_to_jpeg_file_in_memory(
-                            jpgData, jpgDataSize, obj->pix_->w, obj->pix_->h,
-                            3, &imgData[0], params)) {
-                    error = 1;
-                }
-            } else {
-                // To JPG
-                jpgDataSize = obj->pix_->w * obj->pix_->h + 1024;
-                jpgData = (char*)malloc(jpgDataSize);
-                if (!jpge::compress_image_to_jpeg_file_in_memory(
-                            jpgData, jpgDataSize, obj->pix_->w, obj->pix_->h,
-                            1, &imgData[0], params)) {
-                    error = 1;
-                }
+        EncodeOptions options;
+        if (argc >= 2) {
+            const char *optionsError = toEncodeOptions(info[1], format, &options);
+            if (optionsError) {
+                return Nan::ThrowTypeError(optionsError);
             }
         }
+        Nan::Callback *callback = new Nan::Callback(info[argc].As<Function>());
+        Nan::AsyncQueueWorker(new EncodeWorker(info.This(), format, options, callback));
     } else {
-        return Nan::ThrowError("invalid PIX depth");
+        return Nan::ThrowTypeError("expected (format: String, [quality: Int32 | options: Object], callback: Function)");
     }
-    if (error) {
-        std::stringstream msg;
-        msg << "error while encoding '" << lodepng_error_text(error) << "'";
-        return Nan::ThrowError(msg.str().c_str());
-    }
-    if (formatInt == FORMAT_PNG) {
-        info.GetReturnValue().Set(Nan::CopyBuffer(reinterpret_cast<char *>(&pngData[0]), pngData.size()).ToLocalChecked());
-    } else if (formatInt == FORMAT_JPG) {
-        info.GetReturnValue().Set(Nan::CopyBuffer(jpgData, jpgDataSize).ToLocalChecked());
-        free(jpgData);
+}
+
+NAN_METHOD(Image::Pipeline)
+{
+    Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
+    if (info.Length() == 2 && info[0]->IsArray() && info[1]->IsFunction()) {
+        std::vector<PipelineOp> ops;
+        std::string error;
+        if (!parsePipeline(info[0].As<Array>(), ops, error)) {
+            return Nan::ThrowTypeError(error.c_str());
+        }
+        Nan::Callback *callback = new Nan::Callback(info[1].As<Function>());
+        Nan::AsyncQueueWorker(new PipelineWorker(callback, info.This(), Share(obj->pix_), ops));
+    } else {
+        return Nan::ThrowTypeError("expected (ops: Array, callback: Function)");
+    }
+}
+
+// Drops the Pix reference held by a buffer from pixels().
+static void releasePixelData(char *data, void *hint)
+{
+    Pix *pix = static_cast<Pix*>(hint);
+    pixDestroy(&pix);
+}
+
+NAN_METHOD(Image::PixelData)
+{
+    Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.This());
+    CheckDisposed(obj);
+    // V8 rejects a second ArrayBuffer over the same memory, so the buffer is
+    // created once per Pix and keeps its own reference to it. Ops that replace
+    // the Pix, including in-place ops on a Pix shared with a running job,
+    // leave the buffer with the old pixels; callers must call pixels() again
+    // after modifying the Image.
+    Local<Object> buffer;
+    if (obj->pixels_.IsEmpty()) {
+        Pix *pix = pixClone(obj->pix_);
+        size_t length = static_cast<size_t>(pix->wpl) * 4 * pix->h;
+        buffer = Nan::NewBuffer(reinterpret_cast<char *>(pix->data), length,
+                                releasePixelData, pix).ToLocalChecked();
+        obj->pixels_.Reset(buffer);
+    } else {
+        buffer = Nan::New(obj->pixels_);
+    }
+    // Rows are wpl 32-bit words in native byte order, with the first pixel in
+    // the most significant bits of each word.
+    Local<Object> result = Nan::New<Object>();
+    result->Set(Nan::New("data").ToLocalChecked(), buffer);
+    result->Set(Nan::New("width").ToLocalChecked(), Nan::New<Int32>(obj->pix_->w));
+    result->Set(Nan::New("height").ToLocalChecked(), Nan::New<Int32>(obj->pix_->h));
+    result->Set(Nan::New("depth").ToLocalChecked(), Nan::New<Int32>(obj->pix_->d));
+    result->Set(Nan::New("wpl").ToLocalChecked(), Nan::New<Int32>(obj->pix_->wpl));
+    result->Set(Nan::New("stride").ToLocalChecked(), Nan::New<Int32>(obj->pix_->wpl * 4));
+    result->Set(Nan::New("byteOrder").ToLocalChecked(), Nan::New(hostByteOrder).ToLocalChecked());
+    info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(Image::Dispose)
+{
+    Image *obj = Nan::ObjectWrap::Unwrap<Image>(info.Holder());
+    obj->Release();
+}
+
+NAN_METHOD(Image::Decode)
+{
+    int argc = info.Length() - 1;
+    if ((argc == 2 || (argc == 3 && info[2]->IsObject())) && info[0]->IsString()
+            && node::Buffer::HasInstance(info[1]) && info[argc]->IsFunction()) {
+        DecodeOptions options;
+        if (argc == 3 && !toDecodeOptions(info[2], &options)) {
+            return Nan::ThrowTypeError("scale must be 1, 1/2, 1/4 or 1/8");
+        }
+        String::Utf8Value formatStr(info[0]->ToString());
+        ImageFormat format = toImageFormat(*formatStr);
+        if (format != FORMAT_PNG && format != FORMAT_JPG) {
+            std::stringstream msg;
+            msg << "invalid buffer format '" << *formatStr << "'";
+            return Nan::ThrowError(msg.str().c_str());
+        }
+        Nan::Callback *callback = new Nan::Callback(info[argc].As<Function>());
+        Nan::AsyncQueueWorker(new DecodeWorker(info[1]->ToObject(), format, options, callback));
     } else {
-        info.GetReturnValue().Set(Nan::CopyBuffer(reinterpret_cast<char *>(&imgData[0]), imgData.size()).ToLocalChecked());
+        return Nan::ThrowTypeError("expected (format: String, image: Buffer, [options: Object], callback: Function)");
     }
 }
 
 Image::Image(Pix *pix)
-    : pix_(pix)
+    : pix_(pix), wrapped_(false), accounted_(0)
 {
     if (pix_) {
         pixSetYRes(pix_, 300);
-        Nan::AdjustExternalMemory(size());
+        Account();
     }
 }
 
+Image::Image(Pix *pix, Local<Object> buffer)
+    : pix_(pix), wrapped_(true), accounted_(0)
+{
+    pixSetYRes(pix_, 300);
+    pixels_.Reset(buffer);
+    Account();
+}
+
 Image::~Image()
 {
-    if (pix_) {
-        Nan::AdjustExternalMemory(-size());
+    Release();
+}
+
+void Image::Release()
+{
+    pixels_.Reset();
+    if (pix_ && wrapped_) {
+        {
+            std::lock_guard<std::mutex> lock(wrappedPixMutex);
+            wrappedPix.erase(pix_);
+        }
+        // Borrowed Pix are never cloned (see Share), so this is the only
+        // reference and no one else is left with the detached data.
+        pixSetData(pix_, NULL);
+        pixDestroy(&pix_);
+    } else if (pix_) {
         pixDestroy(&pix_);
     }
+    wrapped_ = false;
+    Account();
+}
+
+void Image::Replace(Pix *pixd)
+{
+    if (pixd == pix_) {
+        return;
+    }
+    if (pix_) {
+        pixCopyResolution(pixd, pix_);
+    }
+    Release();
+    pix_ = pixd;
+    Account();
+}
+
+Pix *Image::Writable()
+{
+    // Besides this Image, only a buffer from pixels() may share pix_.
+    int owners = 1 + (!wrapped_ && !pixels_.IsEmpty() ? 1 : 0);
+    if (pixGetRefcount(pix_) > owners) {
+        Replace(pixCopy(NULL, pix_));
+    }
+    return pix_;
+}
+
+Local<Value> Image::Output(Pix *pixd, bool inPlace, Local<Object> self)
+{
+    if (!inPlace) {
+        return Image::New(pixd);
+    }
+    Replace(pixd);
+    // In-place ops may have added a colormap.
+    Account();
+    return self;
 }
 
 int Image::size() const
 {
-    return pix_->h * pix_->wpl * sizeof(uint32_t);
+    if (!pix_) {
+        return 0;
+    }
+    // Borrowed data is accounted by V8 with its Buffer.
+    int data = wrapped_ ? pixGetWpl(pix_) * 4 * pixGetHeight(pix_) : 0;
+    return pixMemorySize(pix_) - data;
+}
+
+void Image::Account()
+{
+    int current = size();
+    if (current != accounted_) {
+        Nan::AdjustExternalMemory(current - accounted_);
+        accounted_ = current;
+    }
 }
 
 }
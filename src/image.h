@@ -12,16 +12,21 @@
 #include <node.h>
 #include <nan.h>
 #include <allheaders.h>
+#include "util.h"
 
 namespace binding {
 
 class Image : public Nan::ObjectWrap
 {
 public:
-    static Nan::Persistent<v8::FunctionTemplate> constructor_template;
+    static PerIsolate<v8::FunctionTemplate> constructor_template;
 
+    // Returns false for empty or disposed Images.
     static bool HasInstance(v8::Handle<v8::Value> val);
     static Pix *Pixels(v8::Local<v8::Object> obj);
+    // Returns a reference to pix for a job that may outlive its Image. Data
+    // borrowed from a Buffer is copied, as the Buffer may be collected first.
+    static Pix *Share(Pix *pix);
 
     static NAN_MODULE_INIT(Init);
 
@@ -79,13 +84,43 @@ private:
     static NAN_METHOD(DrawLine);
     static NAN_METHOD(DrawImage);
     static NAN_METHOD(ToBuffer);
+    static NAN_METHOD(ToBufferAsync);
+    static NAN_METHOD(Pipeline);
+    static NAN_METHOD(PixelData);
+    static NAN_METHOD(Dispose);
+
+    // Static methods.
+    static NAN_METHOD(Decode);
 
     Image(Pix *pix);
+    // Wraps a Pix whose data is borrowed from buffer.
+    Image(Pix *pix, v8::Local<v8::Object> buffer);
     ~Image();
 
+    // Returns the native bytes owned by this Image.
     int size() const;
+    // Reports changes of size() to V8.
+    void Account();
+
+    // Releases pix_ together with any buffer aliasing it.
+    void Release();
+    // Adopts pixd as pix_, keeping the resolution.
+    void Replace(Pix *pixd);
+    // Returns pix_ ready to be modified in place. A Pix that is shared with
+    // other Images or running jobs is copied first, after which a buffer
+    // previously returned by pixels() no longer aliases this Image.
+    Pix *Writable();
+    // Returns pixd as a new Image, or adopts it and returns self if inPlace.
+    v8::Local<v8::Value> Output(Pix *pixd, bool inPlace, v8::Local<v8::Object> self);
 
     Pix *pix_;
+    // Set if pix_->data is borrowed from the Buffer in pixels_.
+    bool wrapped_;
+    // Buffer aliasing pix_->data, created by pixels() or pinned by wrap and
+    // dropped whenever pix_ is replaced.
+    Nan::Persistent<v8::Object> pixels_;
+    // Bytes currently reported to V8 as external memory.
+    int accounted_;
 };
 
 }
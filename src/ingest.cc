@@ -0,0 +1,263 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#include "ingest.h"
+#include <cstring>
+
+#if !defined(L_BIG_ENDIAN) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define INGEST_X86
+#include <immintrin.h>
+#endif
+
+#if defined(INGEST_X86) && defined(__GNUC__)
+// Kernels are compiled for their instruction set and chosen at runtime.
+#define INGEST_TARGET(isa) __attribute__((target(isa)))
+#define INGEST_HAS(isa) __builtin_cpu_supports(isa)
+#elif defined(INGEST_X86)
+// MSVC emits any intrinsic, but only what /arch enables is assumed present.
+#define INGEST_TARGET(isa)
+#if defined(__AVX2__)
+#define INGEST_HAS(isa) true
+#else
+#define INGEST_HAS(isa) (strcmp(isa, "sse2") == 0)
+#endif
+#endif
+
+namespace binding {
+
+namespace {
+
+// Scalar kernels. They build word values, so they work for either host
+// byte order, and finish the rows of the vector kernels. x is the first
+// pixel to convert; for gray it must be a multiple of 4.
+
+void grayScalar(const uint8_t *src, int bpp, uint32_t *dst, int x, int width)
+{
+    for (; x < width; x += 4) {
+        uint32_t word = 0;
+        for (int i = 0; i < 4; ++i) {
+            word <<= 8;
+            if (x + i < width) {
+                word |= src[(x + i) * bpp];
+            }
+        }
+        dst[x / 4] = word;
+    }
+}
+
+void rgbScalar(const uint8_t *src, int bpp, uint32_t *dst, int x, int width)
+{
+    for (; x < width; ++x) {
+        const uint8_t *p = src + x * bpp;
+        dst[x] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8);
+    }
+}
+
+#ifdef INGEST_X86
+
+// Byte swaps each 32-bit lane: little-endian loads into MSB-first words.
+INGEST_TARGET("sse2")
+inline __m128i bswap32(__m128i v)
+{
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+INGEST_TARGET("sse2")
+int graySSE2(const uint8_t *src, uint32_t *dst, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x / 4), bswap32(v));
+    }
+    return x;
+}
+
+// Gathers the first byte of 16 RGBA pixels.
+INGEST_TARGET("sse2")
+int rgbaGraySSE2(const uint8_t *src, uint32_t *dst, int width)
+{
+    const __m128i low = _mm_set1_epi32(0xff);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *p = reinterpret_cast<const __m128i *>(src + x * 4);
+        __m128i a = _mm_and_si128(_mm_loadu_si128(p + 0), low);
+        __m128i b = _mm_and_si128(_mm_loadu_si128(p + 1), low);
+        __m128i c = _mm_and_si128(_mm_loadu_si128(p + 2), low);
+        __m128i d = _mm_and_si128(_mm_loadu_si128(p + 3), low);
+        __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x / 4), bswap32(v));
+    }
+    return x;
+}
+
+INGEST_TARGET("sse2")
+int rgbaSSE2(const uint8_t *src, uint32_t *dst, int width)
+{
+    const __m128i noAlpha = _mm_set1_epi32(0xffffff00);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_and_si128(bswap32(v), noAlpha));
+    }
+    return x;
+}
+
+// Loads 16 bytes per 4 pixels, so it stops short of the row end.
+INGEST_TARGET("ssse3")
+int rgbSSSE3(const uint8_t *src, uint32_t *dst, int width)
+{
+    const __m128i order = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+    int x = 0;
+    for (; (width - x) * 3 >= 16; x += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_shuffle_epi8(v, order));
+    }
+    return x;
+}
+
+INGEST_TARGET("avx2")
+int grayAVX2(const uint8_t *src, uint32_t *dst, int width)
+{
+    const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x / 4), _mm256_shuffle_epi8(v, order));
+    }
+    return x;
+}
+
+INGEST_TARGET("avx2")
+int rgbaGrayAVX2(const uint8_t *src, uint32_t *dst, int width)
+{
+    const __m256i low = _mm256_set1_epi32(0xff);
+    // Packing works per 128-bit lane; this restores the pixel order.
+    const __m256i lanes = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i *p = reinterpret_cast<const __m256i *>(src + x * 4);
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256(p + 0), low);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256(p + 1), low);
+        __m256i c = _mm256_and_si256(_mm256_loadu_si256(p + 2), low);
+        __m256i d = _mm256_and_si256(_mm256_loadu_si256(p + 3), low);
+        __m256i v = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        v = _mm256_permutevar8x32_epi32(v, lanes);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x / 4), _mm256_shuffle_epi8(v, order));
+    }
+    return x;
+}
+
+INGEST_TARGET("avx2")
+int rgbaAVX2(const uint8_t *src, uint32_t *dst, int width)
+{
+    const __m256i order = _mm256_setr_epi8(-1, 2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12,
+                                           -1, 2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), _mm256_shuffle_epi8(v, order));
+    }
+    return x;
+}
+
+// Loads 4 pixels into each 128-bit lane, reading 4 bytes ahead.
+INGEST_TARGET("avx2")
+int rgbAVX2(const uint8_t *src, uint32_t *dst, int width)
+{
+    const __m256i order = _mm256_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9,
+                                           -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+    int x = 0;
+    for (; (width - x) * 3 >= 28; x += 8) {
+        const uint8_t *p = src + x * 3;
+        __m256i v = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), _mm256_shuffle_epi8(v, order));
+    }
+    return x;
+}
+
+enum Isa { ISA_SCALAR, ISA_SSE2, ISA_SSSE3, ISA_AVX2 };
+
+Isa detectIsa()
+{
+    if (INGEST_HAS("avx2")) {
+        return ISA_AVX2;
+    } else if (INGEST_HAS("ssse3")) {
+        return ISA_SSSE3;
+    } else if (INGEST_HAS("sse2")) {
+        return ISA_SSE2;
+    }
+    return ISA_SCALAR;
+}
+
+Isa isa()
+{
+    static const Isa detected = detectIsa();
+    return detected;
+}
+
+#endif
+
+}
+
+void ingestGrayRow(const uint8_t *src, int bytesPerPixel, uint32_t *dst, int width)
+{
+    int x = 0;
+#ifdef INGEST_X86
+    Isa level = isa();
+    if (bytesPerPixel == 1) {
+        if (level >= ISA_AVX2) {
+            x = grayAVX2(src, dst, width);
+        }
+        if (level >= ISA_SSE2) {
+            x += graySSE2(src + x, dst + x / 4, width - x);
+        }
+    } else if (bytesPerPixel == 4) {
+        if (level >= ISA_AVX2) {
+            x = rgbaGrayAVX2(src, dst, width);
+        }
+        if (level >= ISA_SSE2) {
+            x += rgbaGraySSE2(src + x * 4, dst + x / 4, width - x);
+        }
+    }
+#endif
+    grayScalar(src, bytesPerPixel, dst, x, width);
+}
+
+void ingestRGBRow(const uint8_t *src, int bytesPerPixel, uint32_t *dst, int width)
+{
+    int x = 0;
+#ifdef INGEST_X86
+    Isa level = isa();
+    if (bytesPerPixel == 4) {
+        if (level >= ISA_AVX2) {
+            x = rgbaAVX2(src, dst, width);
+        }
+        if (level >= ISA_SSE2) {
+            x += rgbaSSE2(src + x * 4, dst + x, width - x);
+        }
+    } else if (bytesPerPixel == 3) {
+        if (level >= ISA_AVX2) {
+            x = rgbAVX2(src, dst, width);
+        }
+        if (level >= ISA_SSSE3) {
+            x += rgbSSSE3(src + x * 3, dst + x, width - x);
+        }
+    }
+#endif
+    rgbScalar(src, bytesPerPixel, dst, x, width);
+}
+
+}
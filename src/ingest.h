@@ -0,0 +1,30 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdint.h>
+
+namespace binding {
+
+// Row conversion kernels from interleaved 8-bit channels to Leptonica words
+// (MSB-first within each 32-bit word). The fastest kernel the CPU supports
+// (AVX2, SSSE3, SSE2 or scalar) is picked on first use. Rows must be
+// padded to whole words on the Pix side; padding bytes are zeroed.
+
+// Writes the first channel of width pixels of bytesPerPixel as 8bpp gray.
+void ingestGrayRow(const uint8_t *src, int bytesPerPixel, uint32_t *dst, int width);
+
+// Writes width RGB (3) or RGBA (4 bytesPerPixel) pixels as 32bpp, dropping
+// alpha like composeRGBPixel.
+void ingestRGBRow(const uint8_t *src, int bytesPerPixel, uint32_t *dst, int width);
+
+}
+
+#endif
@@ -9,14 +9,21 @@
 #include <node.h> // Side-effects required for VS build!
 #include <nan.h>
 #include "image.h"
+#include "pagecache.h"
+#include "pixpool.h"
 #include "tesseract.h"
+#include "tesseractpool.h"
 #include "zxing.h"
 
 NAN_MODULE_INIT(InitAll)
 {
+    binding::PixPool::Init(target);
     binding::Image::Init(target);
+    binding::PageCache::Init(target);
     binding::Tesseract::Init(target);
+    binding::TesseractPool::Init(target);
     binding::ZXing::Init(target);
 }
 
-NODE_MODULE(dvBinding, InitAll)
+// Context-aware, so that the addon can be loaded in several worker threads.
+NAN_MODULE_WORKER_ENABLED(dvBinding, InitAll)
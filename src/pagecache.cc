@@ -0,0 +1,241 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#include "pagecache.h"
+#include "image.h"
+#include <cstring>
+#include <utility>
+#include <lodepng.h>
+
+using namespace v8;
+
+namespace binding {
+
+NAN_MODULE_INIT(PageCache::Init)
+{
+    auto ctor = Nan::New<v8::FunctionTemplate>(New);
+    auto ctorInst = ctor->InstanceTemplate();
+    auto name = Nan::New("PageCache").ToLocalChecked();
+    ctor->SetClassName(name);
+    ctorInst->SetInternalFieldCount(1);
+
+    Local<ObjectTemplate> proto = ctor->PrototypeTemplate();
+    Nan::SetAccessor(proto, Nan::New("budget").ToLocalChecked(), GetBudget, SetBudget);
+    Nan::SetAccessor(proto, Nan::New("bytes").ToLocalChecked(), GetBytes);
+    Nan::SetAccessor(proto, Nan::New("count").ToLocalChecked(), GetCount);
+
+    Nan::SetPrototypeMethod(ctor, "set", Set);
+    Nan::SetPrototypeMethod(ctor, "get", Get);
+    Nan::SetPrototypeMethod(ctor, "has", Has);
+    Nan::SetPrototypeMethod(ctor, "delete", Delete);
+    Nan::SetPrototypeMethod(ctor, "clear", Clear);
+
+    Nan::Set(target, name, ctor->GetFunction());
+}
+
+NAN_METHOD(PageCache::New)
+{
+    if (info.Length() != 1 || !info[0]->IsNumber() || info[0]->NumberValue() < 0) {
+        return Nan::ThrowTypeError("cannot convert argument list to "
+                     "(budget: Number)");
+    }
+    PageCache* obj = new PageCache(static_cast<size_t>(info[0]->NumberValue()));
+    obj->Wrap(info.This());
+}
+
+NAN_GETTER(PageCache::GetBudget)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    info.GetReturnValue().Set(Nan::New<Number>(obj->budget_));
+}
+
+NAN_SETTER(PageCache::SetBudget)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    if (value->IsNumber() && value->NumberValue() >= 0) {
+        obj->budget_ = static_cast<size_t>(value->NumberValue());
+        obj->Evict();
+    } else {
+        Nan::ThrowTypeError("value must be a non-negative Number");
+    }
+}
+
+NAN_GETTER(PageCache::GetBytes)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    info.GetReturnValue().Set(Nan::New<Number>(obj->bytes_));
+}
+
+NAN_GETTER(PageCache::GetCount)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    info.GetReturnValue().Set(Nan::New<Number>(obj->entries_.size()));
+}
+
+NAN_METHOD(PageCache::Set)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    if (info.Length() != 2 || !info[0]->IsString() || !Image::HasInstance(info[1])) {
+        return Nan::ThrowTypeError("expected (key: String, image: Image)");
+    }
+    Entry entry;
+    entry.key = *String::Utf8Value(info[0]->ToString());
+    if (!Compress(Image::Pixels(info[1]->ToObject()), entry)) {
+        return Nan::ThrowError("error while compressing image");
+    }
+    std::unordered_map<std::string, EntryList::iterator>::iterator existing = obj->index_.find(entry.key);
+    if (existing != obj->index_.end()) {
+        obj->Remove(existing->second);
+    }
+    // An image larger than the whole budget is not kept at all.
+    if (entry.size() <= obj->budget_) {
+        size_t size = entry.size();
+        obj->entries_.push_front(std::move(entry));
+        entry.colormap = NULL;
+        obj->index_[obj->entries_.front().key] = obj->entries_.begin();
+        obj->bytes_ += size;
+        Nan::AdjustExternalMemory(static_cast<int>(size));
+        obj->Evict();
+    }
+    pixcmapDestroy(&entry.colormap);
+    info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(PageCache::Get)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    if (info.Length() != 1 || !info[0]->IsString()) {
+        return Nan::ThrowTypeError("expected (key: String)");
+    }
+    std::string key = *String::Utf8Value(info[0]->ToString());
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = obj->index_.find(key);
+    if (found == obj->index_.end()) {
+        info.GetReturnValue().SetNull();
+        return;
+    }
+    obj->entries_.splice(obj->entries_.begin(), obj->entries_, found->second);
+    Pix *pix = Decompress(*found->second);
+    if (!pix) {
+        return Nan::ThrowError("error while decompressing image");
+    }
+    info.GetReturnValue().Set(Image::New(pix, pixGetYRes(pix)));
+}
+
+NAN_METHOD(PageCache::Has)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    if (info.Length() != 1 || !info[0]->IsString()) {
+        return Nan::ThrowTypeError("expected (key: String)");
+    }
+    std::string key = *String::Utf8Value(info[0]->ToString());
+    info.GetReturnValue().Set(Nan::New(obj->index_.count(key) > 0));
+}
+
+NAN_METHOD(PageCache::Delete)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    if (info.Length() != 1 || !info[0]->IsString()) {
+        return Nan::ThrowTypeError("expected (key: String)");
+    }
+    std::string key = *String::Utf8Value(info[0]->ToString());
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = obj->index_.find(key);
+    if (found == obj->index_.end()) {
+        info.GetReturnValue().Set(Nan::False());
+        return;
+    }
+    obj->Remove(found->second);
+    info.GetReturnValue().Set(Nan::True());
+}
+
+NAN_METHOD(PageCache::Clear)
+{
+    PageCache* obj = Nan::ObjectWrap::Unwrap<PageCache>(info.This());
+    while (!obj->entries_.empty()) {
+        obj->Remove(obj->entries_.begin());
+    }
+    info.GetReturnValue().Set(info.This());
+}
+
+size_t PageCache::Entry::size() const
+{
+    size_t result = sizeof(Entry) + key.size() + data.size();
+    if (colormap) {
+        result += sizeof(PixColormap) + colormap->nalloc * sizeof(RGBA_QUAD);
+    }
+    return result;
+}
+
+PageCache::PageCache(size_t budget)
+    : budget_(budget), bytes_(0)
+{
+}
+
+PageCache::~PageCache()
+{
+    while (!entries_.empty()) {
+        Remove(entries_.begin());
+    }
+}
+
+void PageCache::Remove(EntryList::iterator entry)
+{
+    size_t size = entry->size();
+    bytes_ -= size;
+    Nan::AdjustExternalMemory(-static_cast<int>(size));
+    index_.erase(entry->key);
+    pixcmapDestroy(&entry->colormap);
+    entries_.erase(entry);
+}
+
+void PageCache::Evict()
+{
+    while (bytes_ > budget_ && !entries_.empty()) {
+        Remove(--entries_.end());
+    }
+}
+
+bool PageCache::Compress(Pix *pix, Entry &entry)
+{
+    entry.width = pixGetWidth(pix);
+    entry.height = pixGetHeight(pix);
+    entry.depth = pixGetDepth(pix);
+    entry.wpl = pixGetWpl(pix);
+    entry.xres = pixGetXRes(pix);
+    entry.yres = pixGetYRes(pix);
+    entry.colormap = pixGetColormap(pix) ? pixcmapCopy(pixGetColormap(pix)) : NULL;
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(pixGetData(pix));
+    size_t length = static_cast<size_t>(entry.wpl) * 4 * entry.height;
+    if (lodepng::compress(entry.data, data, length) != 0) {
+        pixcmapDestroy(&entry.colormap);
+        return false;
+    }
+    entry.data.shrink_to_fit();
+    return true;
+}
+
+Pix *PageCache::Decompress(const Entry &entry)
+{
+    std::vector<unsigned char> data;
+    size_t length = static_cast<size_t>(entry.wpl) * 4 * entry.height;
+    if (lodepng::decompress(data, &entry.data[0], entry.data.size()) != 0
+            || data.size() != length) {
+        return NULL;
+    }
+    Pix *pix = pixCreateNoInit(entry.width, entry.height, entry.depth);
+    if (!pix) {
+        return NULL;
+    }
+    memcpy(pixGetData(pix), &data[0], length);
+    pixSetResolution(pix, entry.xres, entry.yres);
+    if (entry.colormap) {
+        pixSetColormap(pix, pixcmapCopy(entry.colormap));
+    }
+    return pix;
+}
+
+}
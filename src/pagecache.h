@@ -0,0 +1,85 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <node.h>
+#include <v8.h>
+#include <nan.h>
+#include <allheaders.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "util.h"
+
+namespace binding {
+
+// Keeps images deflate-compressed in memory, keyed by String. Entries are
+// decompressed on every get(), and the least recently used ones are evicted
+// once the compressed size exceeds the budget.
+class PageCache : public Nan::ObjectWrap
+{
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    static NAN_METHOD(New);
+
+    // Accessors.
+    static NAN_GETTER(GetBudget);
+    static NAN_SETTER(SetBudget);
+    static NAN_GETTER(GetBytes);
+    static NAN_GETTER(GetCount);
+
+    // Methods.
+    static NAN_METHOD(Set);
+    static NAN_METHOD(Get);
+    static NAN_METHOD(Has);
+    static NAN_METHOD(Delete);
+    static NAN_METHOD(Clear);
+
+    // A compressed Pix. Raw words are stored, so any depth and colormap
+    // round-trips exactly.
+    struct Entry
+    {
+        std::string key;
+        int width;
+        int height;
+        int depth;
+        int wpl;
+        int xres;
+        int yres;
+        PixColormap *colormap;
+        std::vector<unsigned char> data;
+
+        size_t size() const;
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    explicit PageCache(size_t budget);
+    ~PageCache();
+
+    void Remove(EntryList::iterator entry);
+    void Evict();
+
+    static bool Compress(Pix *pix, Entry &entry);
+    static Pix *Decompress(const Entry &entry);
+
+    size_t budget_;
+    size_t bytes_;
+    // Most recently used first.
+    EntryList entries_;
+    std::unordered_map<std::string, EntryList::iterator> index_;
+};
+
+}
+
+#endif
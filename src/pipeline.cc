@@ -0,0 +1,361 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#include "pipeline.h"
+#include "image.h"
+#include "util.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+using namespace v8;
+
+namespace binding {
+
+struct PipelineOpSpec
+{
+    const char *name;
+    PipelineOpType type;
+    int required;
+    const char *params[5];
+};
+
+static const PipelineOpSpec pipelineOpSpecs[] = {
+    { "invert", OP_INVERT, 0, { NULL } },
+    { "toGray", OP_TO_GRAY, 0, { NULL } },
+    { "toColor", OP_TO_COLOR, 0, { NULL } },
+    { "scale", OP_SCALE, 1, { "x", "y", NULL } },
+    { "rotate", OP_ROTATE, 0, { "angle", NULL } },
+    { "crop", OP_CROP, 4, { "x", "y", "width", "height", NULL } },
+    { "threshold", OP_THRESHOLD, 0, { "value", NULL } },
+    { "otsuAdaptiveThreshold", OP_OTSU_ADAPTIVE_THRESHOLD, 5,
+      { "sx", "sy", "smoothx", "smoothy", "scoreFact" } },
+    { "convolve", OP_CONVOLVE, 2, { "width", "height", NULL } },
+    { "unsharp", OP_UNSHARP, 2, { "halfWidth", "fract", NULL } },
+    { "erode", OP_ERODE, 2, { "width", "height", NULL } },
+    { "dilate", OP_DILATE, 2, { "width", "height", NULL } },
+    { "open", OP_OPEN, 2, { "width", "height", NULL } },
+    { "close", OP_CLOSE, 2, { "width", "height", NULL } },
+    { "findSkew", OP_FIND_SKEW, 0, { NULL } },
+    { "connectedComponents", OP_CONNECTED_COMPONENTS, 1, { "connectivity", NULL } }
+};
+
+static const size_t pipelineOpSpecsLength =
+        sizeof(pipelineOpSpecs) / sizeof(pipelineOpSpecs[0]);
+
+static const PipelineOpSpec *findPipelineOpSpec(PipelineOpType type)
+{
+    for (size_t i = 0; i < pipelineOpSpecsLength; ++i) {
+        if (pipelineOpSpecs[i].type == type) {
+            return &pipelineOpSpecs[i];
+        }
+    }
+    return NULL;
+}
+
+bool parsePipeline(Local<Array> ops, std::vector<PipelineOp> &result,
+                   std::string &error)
+{
+    bool hasSkew = false;
+    for (uint32_t i = 0; i < ops->Length(); ++i) {
+        std::ostringstream prefix;
+        prefix << "op " << i << ": ";
+        Local<Value> item = Nan::Get(ops, i).ToLocalChecked();
+        if (!item->IsObject()) {
+            error = prefix.str() + "expected {op: String}";
+            return false;
+        }
+        Local<Object> object = item->ToObject();
+        Local<Value> name = Nan::Get(object, Nan::New("op").ToLocalChecked()).ToLocalChecked();
+        const PipelineOpSpec *spec = NULL;
+        if (name->IsString()) {
+            String::Utf8Value nameStr(name);
+            for (size_t j = 0; j < pipelineOpSpecsLength; ++j) {
+                if (strcmp(pipelineOpSpecs[j].name, *nameStr) == 0) {
+                    spec = &pipelineOpSpecs[j];
+                    break;
+                }
+            }
+        }
+        if (!spec) {
+            error = prefix.str() + "unknown op";
+            return false;
+        }
+        prefix.str("");
+        prefix << "op " << i << " (" << spec->name << "): ";
+
+        PipelineOp op;
+        op.type = spec->type;
+        op.mode = 0;
+        op.useSkew = false;
+        for (int j = 0; j < 5; ++j) {
+            op.params[j] = std::numeric_limits<double>::quiet_NaN();
+        }
+        for (int j = 0; j < 5; ++j) {
+            if (!spec->params[j]) {
+                break;
+            }
+            Local<Value> value = Nan::Get(object, Nan::New(spec->params[j]).ToLocalChecked()).ToLocalChecked();
+            if (value->IsNumber()) {
+                op.params[j] = value->NumberValue();
+            } else if (j < spec->required || !value->IsUndefined()) {
+                error = prefix.str() + "expected " + spec->params[j] + ": Number";
+                return false;
+            }
+        }
+
+        Local<Value> output = Nan::Get(object, Nan::New("output").ToLocalChecked()).ToLocalChecked();
+        if (output->IsString()) {
+            op.output = *String::Utf8Value(output);
+        } else if (!output->IsUndefined()) {
+            error = prefix.str() + "expected output: String";
+            return false;
+        }
+
+        switch (op.type) {
+        case OP_TO_GRAY: {
+            Local<Value> type = Nan::Get(object, Nan::New("type").ToLocalChecked()).ToLocalChecked();
+            if (!type->IsUndefined()) {
+                String::Utf8Value typeStr(type);
+                if (strcmp("min", *typeStr) == 0) {
+                    op.mode = L_CHOOSE_MIN;
+                } else if (strcmp("max", *typeStr) == 0) {
+                    op.mode = L_CHOOSE_MAX;
+                } else {
+                    error = prefix.str() + "expected type to be 'min' or 'max'";
+                    return false;
+                }
+            }
+            break;
+        }
+        case OP_SCALE:
+            if (std::isnan(op.params[1])) {
+                op.params[1] = op.params[0];
+            }
+            break;
+        case OP_ROTATE:
+            // Without an angle, deskew using the last findSkew result.
+            if (std::isnan(op.params[0])) {
+                if (!hasSkew) {
+                    error = prefix.str() + "expected angle: Number or a preceding findSkew";
+                    return false;
+                }
+                op.useSkew = true;
+            }
+            break;
+        case OP_THRESHOLD:
+            if (std::isnan(op.params[0])) {
+                op.params[0] = 128;
+            }
+            break;
+        case OP_FIND_SKEW:
+            hasSkew = true;
+            break;
+        default:
+            break;
+        }
+        result.push_back(op);
+    }
+    if (result.empty()) {
+        error = "expected at least one op";
+        return false;
+    }
+    return true;
+}
+
+PipelineWorker::PipelineWorker(Nan::Callback *callback, Local<Object> image,
+                               Pix *pix, const std::vector<PipelineOp> &ops)
+    : Nan::AsyncWorker(callback), pix_(pix), ops_(ops), skew_(0)
+{
+    SaveToPersistent("image", image);
+}
+
+PipelineWorker::~PipelineWorker()
+{
+    pixDestroy(&pix_);
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+        pixDestroy(&outputs_[i].pix);
+        boxaDestroy(&outputs_[i].boxa);
+    }
+}
+
+void PipelineWorker::Execute()
+{
+    bool named = false;
+    for (size_t i = 0; i < ops_.size(); ++i) {
+        named = named || !ops_[i].output.empty();
+    }
+    for (size_t i = 0; i < ops_.size(); ++i) {
+        Output output;
+        output.name = ops_[i].output;
+        if (!Run(ops_[i], i, output)) {
+            pixDestroy(&output.pix);
+            boxaDestroy(&output.boxa);
+            return;
+        }
+        if (!output.name.empty() || (!named && i + 1 == ops_.size())) {
+            if (ops_[i].type != OP_FIND_SKEW && ops_[i].type != OP_CONNECTED_COMPONENTS) {
+                output.pix = pixClone(pix_);
+            }
+            outputs_.push_back(output);
+        } else {
+            boxaDestroy(&output.boxa);
+        }
+    }
+}
+
+bool PipelineWorker::Run(const PipelineOp &op, size_t index, Output &output)
+{
+    const float deg2rad = 3.1415926535f / 180.0f;
+    const double *p = op.params;
+    Pix *pixd = NULL;
+    switch (op.type) {
+    case OP_INVERT:
+        pixd = pixInvert(NULL, pix_);
+        break;
+    case OP_TO_GRAY:
+        if (pix_->d == 8) {
+            pixd = pixClone(pix_);
+        } else if (op.mode != 0) {
+            pixd = pixConvertRGBToGrayMinMax(pix_, op.mode);
+        } else {
+            pixd = pixConvertTo8(pix_, 0);
+        }
+        break;
+    case OP_TO_COLOR:
+        pixd = pixConvertTo32(pix_);
+        break;
+    case OP_SCALE:
+        pixd = pixScale(pix_, static_cast<float>(p[0]), static_cast<float>(p[1]));
+        break;
+    case OP_ROTATE: {
+        float angle = op.useSkew ? skew_ : static_cast<float>(p[0]);
+        pixd = pixRotate(pix_, deg2rad * angle, L_ROTATE_AREA_MAP,
+                         L_BRING_IN_WHITE, pix_->w, pix_->h);
+        break;
+    }
+    case OP_CROP: {
+        Box *box = boxCreate(floor(p[0]), floor(p[1]), ceil(p[2]), ceil(p[3]));
+        if (box) {
+            pixd = pixClipRectangle(pix_, box, 0);
+            boxDestroy(&box);
+        }
+        break;
+    }
+    case OP_THRESHOLD:
+        pixd = pixConvertTo1(pix_, static_cast<int>(p[0]));
+        break;
+    case OP_OTSU_ADAPTIVE_THRESHOLD: {
+        Pix *pixth = NULL;
+        if (pixOtsuAdaptiveThreshold(pix_, static_cast<int>(p[0]), static_cast<int>(p[1]),
+                                     static_cast<int>(p[2]), static_cast<int>(p[3]),
+                                     static_cast<float>(p[4]), &pixth, &pixd) != 0) {
+            pixd = NULL;
+        }
+        pixDestroy(&pixth);
+        break;
+    }
+    case OP_CONVOLVE: {
+        Pix *pixs = pix_->d == 1 ? pixConvert1To8(NULL, pix_, 0, 255) : pixClone(pix_);
+        pixd = pixBlockconv(pixs, static_cast<int>(ceil(p[0])), static_cast<int>(ceil(p[1])));
+        pixDestroy(&pixs);
+        break;
+    }
+    case OP_UNSHARP:
+        pixd = pixUnsharpMasking(pix_, static_cast<int>(ceil(p[0])), static_cast<float>(p[1]));
+        break;
+    case OP_ERODE:
+    case OP_DILATE:
+    case OP_OPEN:
+    case OP_CLOSE: {
+        int width = static_cast<int>(ceil(p[0]));
+        int height = static_cast<int>(ceil(p[1]));
+        bool binary = pix_->d == 1;
+        if (op.type == OP_ERODE) {
+            pixd = binary ? pixErodeBrick(NULL, pix_, width, height) : pixErodeGray(pix_, width, height);
+        } else if (op.type == OP_DILATE) {
+            pixd = binary ? pixDilateBrick(NULL, pix_, width, height) : pixDilateGray(pix_, width, height);
+        } else if (op.type == OP_OPEN) {
+            pixd = binary ? pixOpenBrick(NULL, pix_, width, height) : pixOpenGray(pix_, width, height);
+        } else {
+            pixd = binary ? pixCloseBrick(NULL, pix_, width, height) : pixCloseGray(pix_, width, height);
+        }
+        break;
+    }
+    case OP_FIND_SKEW:
+        if (pix_->d != 1) {
+            SetErrorMessage("findSkew expected binarized image");
+            return false;
+        }
+        if (pixFindSkew(pix_, &output.angle, &output.confidence) != 0) {
+            SetErrorMessage("angle measurment not valid");
+            return false;
+        }
+        skew_ = output.angle;
+        return true;
+    case OP_CONNECTED_COMPONENTS: {
+        // If image is grayscale, binarize with fixed threshold
+        Pix *pixs = pix_->d != 1 ? pixConvertTo1(pix_, 128) : pixClone(pix_);
+        output.boxa = pixs ? pixConnCompBB(pixs, static_cast<int>(p[0])) : NULL;
+        pixDestroy(&pixs);
+        if (!output.boxa) {
+            SetErrorMessage("error while computing connected components");
+            return false;
+        }
+        return true;
+    }
+    }
+    if (pixd == NULL) {
+        std::ostringstream message;
+        message << "error while applying op " << index << " ("
+                << findPipelineOpSpec(op.type)->name << ")";
+        SetErrorMessage(message.str().c_str());
+        return false;
+    }
+    pixDestroy(&pix_);
+    pix_ = pixd;
+    return true;
+}
+
+void PipelineWorker::HandleOKCallback()
+{
+    Nan::HandleScope scope;
+    bool named = false;
+    Local<Object> results = Nan::New<Object>();
+    Local<Value> result = Nan::Null();
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+        Output &output = outputs_[i];
+        Local<Value> value;
+        if (output.pix) {
+            value = Image::New(output.pix);
+            output.pix = NULL;
+        } else if (output.boxa) {
+            Local<Array> boxes = Nan::New<Array>();
+            for (int j = 0; j < output.boxa->n; ++j) {
+                boxes->Set(j, createBox(output.boxa->box[j]));
+            }
+            value = boxes;
+        } else {
+            Local<Object> skew = Nan::New<Object>();
+            skew->Set(Nan::New("angle").ToLocalChecked(), Nan::New(output.angle));
+            skew->Set(Nan::New("confidence").ToLocalChecked(), Nan::New(output.confidence));
+            value = skew;
+        }
+        if (output.name.empty()) {
+            result = value;
+        } else {
+            named = true;
+            results->Set(Nan::New(output.name).ToLocalChecked(), value);
+        }
+    }
+    Local<Value> argv[] = { Nan::Null(), named ? Local<Value>(results) : result };
+    callback->Call(2, argv, async_resource);
+}
+
+}
@@ -0,0 +1,91 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <node.h>
+#include <v8.h>
+#include <nan.h>
+#include <allheaders.h>
+#include <string>
+#include <vector>
+
+namespace binding {
+
+enum PipelineOpType {
+    OP_INVERT,
+    OP_TO_GRAY,
+    OP_TO_COLOR,
+    OP_SCALE,
+    OP_ROTATE,
+    OP_CROP,
+    OP_THRESHOLD,
+    OP_OTSU_ADAPTIVE_THRESHOLD,
+    OP_CONVOLVE,
+    OP_UNSHARP,
+    OP_ERODE,
+    OP_DILATE,
+    OP_OPEN,
+    OP_CLOSE,
+    OP_FIND_SKEW,
+    OP_CONNECTED_COMPONENTS
+};
+
+// A validated pipeline step. Parameters are kept as plain values, so that
+// the whole chain can run without touching V8.
+struct PipelineOp
+{
+    PipelineOpType type;
+    double params[5];
+    int mode;
+    bool useSkew;
+    std::string output;
+};
+
+// Parses an array of {op: String, ..., [output: String]} descriptions.
+// Returns false and fills error if an op is unknown or malformed.
+bool parsePipeline(v8::Local<v8::Array> ops, std::vector<PipelineOp> &result,
+                   std::string &error);
+
+// Runs a parsed pipeline on a clone of the source image. Intermediate images
+// are released as soon as the next step has consumed them; only ops that
+// name an output (or the last op, if none does) are marshalled back.
+class PipelineWorker : public Nan::AsyncWorker
+{
+public:
+    PipelineWorker(Nan::Callback *callback, v8::Local<v8::Object> image,
+                   Pix *pix, const std::vector<PipelineOp> &ops);
+    ~PipelineWorker();
+
+    void Execute();
+    void HandleOKCallback();
+
+private:
+    struct Output
+    {
+        Output() : pix(NULL), boxa(NULL), angle(0), confidence(0) {}
+
+        std::string name;
+        Pix *pix;
+        Boxa *boxa;
+        float angle;
+        float confidence;
+    };
+
+    bool Run(const PipelineOp &op, size_t index, Output &output);
+
+    Pix *pix_;
+    std::vector<PipelineOp> ops_;
+    std::vector<Output> outputs_;
+    float skew_;
+};
+
+}
+
+#endif
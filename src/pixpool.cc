@@ -0,0 +1,206 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#include "pixpool.h"
+#include <allheaders.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace v8;
+
+namespace binding {
+
+namespace {
+
+struct SizeClass
+{
+    size_t size;
+    size_t count;
+    std::vector<void *> free;
+    double hits;
+    double misses;
+
+    bool operator<(const SizeClass &other) const
+    {
+        return size < other.size;
+    }
+};
+
+std::mutex poolMutex;
+std::vector<SizeClass> sizeClasses;
+// Buffers handed out by the pool, mapped to their size class. Buffers not
+// listed here came from plain malloc.
+std::unordered_map<void *, size_t> pooled;
+double bypassed = 0;
+std::atomic<bool> enabled(false);
+std::atomic<size_t> pooledCount(0);
+std::once_flag installFlag;
+
+void installPixPool()
+{
+    setPixMemoryManager(&PixPool::Alloc, &PixPool::Free);
+}
+
+}
+
+NAN_MODULE_INIT(PixPool::Init)
+{
+    // Leptonica frees with whatever deallocator is current, so the pool is
+    // installed once, before any job runs, and stays a pass-through until
+    // configured.
+    std::call_once(installFlag, installPixPool);
+    Nan::SetMethod(target, "setPixPool", SetPixPool);
+    Nan::SetMethod(target, "pixPoolStats", PixPoolStats);
+}
+
+void *PixPool::Alloc(size_t nbytes)
+{
+    if (!enabled) {
+        return malloc(nbytes);
+    }
+    size_t size;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        SizeClass key;
+        key.size = nbytes;
+        std::vector<SizeClass>::iterator it = std::lower_bound(
+                    sizeClasses.begin(), sizeClasses.end(), key);
+        if (it == sizeClasses.end()) {
+            bypassed++;
+            return malloc(nbytes);
+        }
+        if (!it->free.empty()) {
+            void *data = it->free.back();
+            it->free.pop_back();
+            it->hits++;
+            return data;
+        }
+        it->misses++;
+        size = it->size;
+    }
+    void *data = malloc(size);
+    if (data) {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        pooled[data] = size;
+        pooledCount++;
+    }
+    return data;
+}
+
+void PixPool::Free(void *data)
+{
+    if (!data) {
+        return;
+    }
+    if (pooledCount > 0) {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        std::unordered_map<void *, size_t>::iterator owner = pooled.find(data);
+        if (owner != pooled.end()) {
+            SizeClass key;
+            key.size = owner->second;
+            std::vector<SizeClass>::iterator it = std::lower_bound(
+                        sizeClasses.begin(), sizeClasses.end(), key);
+            if (it != sizeClasses.end() && it->size == owner->second
+                    && it->free.size() < it->count) {
+                it->free.push_back(data);
+                return;
+            }
+            pooled.erase(owner);
+            pooledCount--;
+        }
+    }
+    free(data);
+}
+
+NAN_METHOD(PixPool::SetPixPool)
+{
+    std::vector<SizeClass> classes;
+    if (info[0]->IsObject()) {
+        Local<Object> options = info[0]->ToObject();
+        Local<Value> sizes = Nan::Get(options, Nan::New("sizes").ToLocalChecked()).ToLocalChecked();
+        Local<Value> counts = Nan::Get(options, Nan::New("counts").ToLocalChecked()).ToLocalChecked();
+        if (!sizes->IsArray() || !(counts->IsArray() || counts->IsNumber())) {
+            return Nan::ThrowTypeError("expected {sizes: Array, counts: Array|Number}");
+        }
+        Local<Array> sizesArray = sizes.As<Array>();
+        if (counts->IsArray() && counts.As<Array>()->Length() != sizesArray->Length()) {
+            return Nan::ThrowTypeError("sizes and counts must have the same length");
+        }
+        for (uint32_t i = 0; i < sizesArray->Length(); ++i) {
+            Local<Value> size = Nan::Get(sizesArray, i).ToLocalChecked();
+            Local<Value> count = counts->IsArray()
+                    ? Nan::Get(counts.As<Array>(), i).ToLocalChecked() : counts;
+            if (!size->IsNumber() || size->NumberValue() < 1
+                    || !count->IsNumber() || count->NumberValue() < 0) {
+                return Nan::ThrowTypeError("sizes must be positive and counts non-negative");
+            }
+            SizeClass sizeClass;
+            sizeClass.size = static_cast<size_t>(size->NumberValue());
+            sizeClass.count = static_cast<size_t>(count->NumberValue());
+            sizeClass.hits = sizeClass.misses = 0;
+            classes.push_back(sizeClass);
+        }
+        std::sort(classes.begin(), classes.end());
+    } else if (!info[0]->IsNull() && !info[0]->IsUndefined()) {
+        return Nan::ThrowTypeError("expected options object or null");
+    }
+
+    // Retained buffers of the old classes are released; buffers still in use
+    // go back to the new classes of the same size, or to free().
+    std::vector<void *> released;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        for (size_t i = 0; i < sizeClasses.size(); ++i) {
+            std::vector<void *> &retained = sizeClasses[i].free;
+            for (size_t j = 0; j < retained.size(); ++j) {
+                pooled.erase(retained[j]);
+                pooledCount--;
+            }
+            released.insert(released.end(), retained.begin(), retained.end());
+        }
+        sizeClasses.swap(classes);
+        bypassed = 0;
+        enabled = !sizeClasses.empty();
+    }
+    for (size_t i = 0; i < released.size(); ++i) {
+        free(released[i]);
+    }
+}
+
+NAN_METHOD(PixPool::PixPoolStats)
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    double hits = 0, misses = 0, retained = 0;
+    Local<Array> sizes = Nan::New<Array>(sizeClasses.size());
+    for (size_t i = 0; i < sizeClasses.size(); ++i) {
+        const SizeClass &sizeClass = sizeClasses[i];
+        Local<Object> item = Nan::New<Object>();
+        Nan::Set(item, Nan::New("size").ToLocalChecked(), Nan::New<Number>(sizeClass.size));
+        Nan::Set(item, Nan::New("count").ToLocalChecked(), Nan::New<Number>(sizeClass.count));
+        Nan::Set(item, Nan::New("free").ToLocalChecked(), Nan::New<Number>(sizeClass.free.size()));
+        Nan::Set(item, Nan::New("hits").ToLocalChecked(), Nan::New<Number>(sizeClass.hits));
+        Nan::Set(item, Nan::New("misses").ToLocalChecked(), Nan::New<Number>(sizeClass.misses));
+        Nan::Set(sizes, i, item);
+        hits += sizeClass.hits;
+        misses += sizeClass.misses;
+        retained += static_cast<double>(sizeClass.size) * sizeClass.free.size();
+    }
+    Local<Object> stats = Nan::New<Object>();
+    Nan::Set(stats, Nan::New("hits").ToLocalChecked(), Nan::New<Number>(hits));
+    Nan::Set(stats, Nan::New("misses").ToLocalChecked(), Nan::New<Number>(misses));
+    Nan::Set(stats, Nan::New("bypassed").ToLocalChecked(), Nan::New<Number>(bypassed));
+    Nan::Set(stats, Nan::New("retained").ToLocalChecked(), Nan::New<Number>(retained));
+    Nan::Set(stats, Nan::New("sizes").ToLocalChecked(), sizes);
+    info.GetReturnValue().Set(stats);
+}
+
+}
@@ -0,0 +1,41 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#ifndef PIXPOOL_H
+#define PIXPOOL_H
+
+#include <node.h>
+#include <v8.h>
+#include <nan.h>
+#include <cstddef>
+
+namespace binding {
+
+// Process-wide pool for Pix data buffers, installed into Leptonica through
+// setPixMemoryManager. Buffers are grouped into size classes; freed buffers
+// are kept (up to a per-class count) and handed out again to the next
+// allocation that fits, instead of going back to malloc/free.
+//
+// Leptonica's own pmsCreate store is a fixed arena without locking, so it
+// can't be shared by worker threads or reconfigured at runtime.
+class PixPool
+{
+public:
+    static NAN_MODULE_INIT(Init);
+
+    static void *Alloc(size_t nbytes);
+    static void Free(void *data);
+
+private:
+    static NAN_METHOD(SetPixPool);
+    static NAN_METHOD(PixPoolStats);
+};
+
+}
+
+#endif
@@ -11,10 +11,15 @@
 #include "util.h"
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <set>
+#include <mutex>
 #include <cmath>
+#include <sys/stat.h>
 #include <strngs.h>
 #include <resultiterator.h>
 #include <tesseractclass.h>
+#include <thresholder.h>
 #include <params.h>
 
 using namespace v8;
@@ -22,6 +27,1046 @@ using namespace v8;
 namespace binding {
 
 #define ReturnValue(value) return info.GetReturnValue().Set(Nan::New(value).ToLocalChecked())
+#define CheckBusy(obj) if ((obj)->busy_) return Nan::ThrowError("Tesseract is busy")
+
+// Traineddata files charged to each isolate. The dictionaries, classifier
+// templates and mapped file stay in Tesseract's cache once loaded and are
+// shared by later instances, so each file is charged once per isolate and
+// the charge lasts until its environment shuts down.
+static std::map<Isolate*, std::set<std::string> > chargedModels;
+static std::mutex chargedModelsMutex;
+
+static void releaseModels(void *arg)
+{
+    std::lock_guard<std::mutex> lock(chargedModelsMutex);
+    chargedModels.erase(static_cast<Isolate*>(arg));
+}
+
+// Returns whether path has not been charged to isolate yet and marks it.
+static bool chargeModel(Isolate *isolate, const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(chargedModelsMutex);
+    std::map<Isolate*, std::set<std::string> >::iterator it = chargedModels.find(isolate);
+    if (it == chargedModels.end()) {
+        it = chargedModels.insert(std::make_pair(isolate, std::set<std::string>())).first;
+#if NODE_MODULE_VERSION >= NODE_11_0_MODULE_VERSION
+        node::AddEnvironmentCleanupHook(isolate, releaseModels, isolate);
+#endif
+    }
+    return it->second.insert(path).second;
+}
+
+bool toPageSegMode(const char *name, tesseract::PageSegMode *mode)
+{
+    if (strcmp("osd_only", name) == 0) {
+        *mode = tesseract::PSM_OSD_ONLY;
+    } else if (strcmp("auto_osd", name) == 0) {
+        *mode = tesseract::PSM_AUTO_OSD;
+    } else if (strcmp("auto_only", name) == 0) {
+        *mode = tesseract::PSM_AUTO_ONLY;
+    } else if (strcmp("auto", name) == 0) {
+        *mode = tesseract::PSM_AUTO;
+    } else if (strcmp("single_column", name) == 0) {
+        *mode = tesseract::PSM_SINGLE_COLUMN;
+    } else if (strcmp("single_block_vert_text", name) == 0) {
+        *mode = tesseract::PSM_SINGLE_BLOCK_VERT_TEXT;
+    } else if (strcmp("single_block", name) == 0) {
+        *mode = tesseract::PSM_SINGLE_BLOCK;
+    } else if (strcmp("single_line", name) == 0) {
+        *mode = tesseract::PSM_SINGLE_LINE;
+    } else if (strcmp("single_word", name) == 0) {
+        *mode = tesseract::PSM_SINGLE_WORD;
+    } else if (strcmp("circle_word", name) == 0) {
+        *mode = tesseract::PSM_CIRCLE_WORD;
+    } else if (strcmp("single_char", name) == 0) {
+        *mode = tesseract::PSM_SINGLE_CHAR;
+    } else if (strcmp("sparse_text", name) == 0) {
+        *mode = tesseract::PSM_SPARSE_TEXT;
+    } else if (strcmp("sparse_text_osd", name) == 0) {
+        *mode = tesseract::PSM_SPARSE_TEXT_OSD;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool toPageIteratorLevel(const char *name, tesseract::PageIteratorLevel *level)
+{
+    if (strcmp("region", name) == 0) {
+        *level = tesseract::RIL_BLOCK;
+    } else if (strcmp("paragraph", name) == 0) {
+        *level = tesseract::RIL_PARA;
+    } else if (strcmp("textline", name) == 0) {
+        *level = tesseract::RIL_TEXTLINE;
+    } else if (strcmp("word", name) == 0) {
+        *level = tesseract::RIL_WORD;
+    } else if (strcmp("symbol", name) == 0) {
+        *level = tesseract::RIL_SYMBOL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+enum TextMode
+{
+    TEXT_PLAIN,
+    TEXT_UNLV,
+    TEXT_HOCR,
+    TEXT_BOX
+};
+
+// Parses (mode: String, [pageNumber: Int32], [withConfidence: Boolean]) from
+// the first argc arguments.
+bool toTextMode(Nan::NAN_METHOD_ARGS_TYPE args, int argc, TextMode *mode,
+                int *pageNumber, bool *withConfidence)
+{
+    if (argc < 1 || !args[0]->IsString()) {
+        return false;
+    }
+    String::Utf8Value modeStr(args[0]);
+    *pageNumber = 0;
+    *withConfidence = false;
+    if (argc == 2 && args[1]->IsBoolean()) {
+        *withConfidence = args[1]->BooleanValue();
+    } else if (argc == 3 && args[2]->IsBoolean()) {
+        *withConfidence = args[2]->BooleanValue();
+    }
+    if (strcmp("plain", *modeStr) == 0) {
+        *mode = TEXT_PLAIN;
+    } else if (strcmp("unlv", *modeStr) == 0) {
+        *mode = TEXT_UNLV;
+    } else if (strcmp("hocr", *modeStr) == 0 && argc == 2 && args[1]->IsInt32()) {
+        *mode = TEXT_HOCR;
+        *pageNumber = args[1]->Int32Value();
+    } else if (strcmp("box", *modeStr) == 0 && argc == 2 && args[1]->IsInt32()) {
+        *mode = TEXT_BOX;
+        *pageNumber = args[1]->Int32Value();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+char *getText(tesseract::TessBaseAPI &api, TextMode mode, int pageNumber)
+{
+    switch (mode) {
+    case TEXT_PLAIN:
+        return api.GetUTF8Text();
+    case TEXT_UNLV:
+        return api.GetUNLVText();
+    case TEXT_HOCR:
+        return api.GetHOCRText(pageNumber);
+    case TEXT_BOX:
+        return api.GetBoxText(pageNumber);
+    default:
+        return NULL;
+    }
+}
+
+// Appends the element the iterator is at.
+static void extractResult(tesseract::PageIterator *it, tesseract::PageIteratorLevel level,
+                          bool recognize, std::vector<ResultItem> &items)
+{
+    items.push_back(ResultItem());
+    ResultItem &item = items.back();
+    item.hasBox = it->BoundingBoxInternal(level, &item.left, &item.top,
+                                          &item.right, &item.bottom);
+    item.hasText = false;
+    item.confidence = 0;
+    if (level != tesseract::RIL_TEXTLINE && recognize) {
+        // Extract text.
+        char *text = static_cast<tesseract::ResultIterator *>(it)->GetUTF8Text(level);
+        if (text) {
+            item.hasText = true;
+            item.text = text;
+            delete[] text;
+            // Extract confidence.
+            item.confidence = static_cast<tesseract::ResultIterator *>(it)->Confidence(level);
+        }
+    }
+    item.hasChoices = level == tesseract::RIL_SYMBOL && recognize;
+    if (item.hasChoices) {
+        // Extract choices
+        tesseract::ChoiceIterator choiceIt = tesseract::ChoiceIterator(
+                    *static_cast<tesseract::ResultIterator *>(it));
+        do {
+            const char* text = choiceIt.GetUTF8Text();
+            if (!text) {
+                break;
+            }
+            item.choices.push_back(std::make_pair(std::string(text), choiceIt.Confidence()));
+            // Don't "delete[] text;": it breaks Tesseract 3.02 (documentation bug?)
+        } while (choiceIt.Next());
+    }
+}
+
+bool extractResults(tesseract::PageIterator *it, tesseract::PageIteratorLevel level,
+                    bool recognize, size_t maxCount, std::vector<ResultItem> &items)
+{
+    if (it == NULL) {
+        return false;
+    }
+    size_t count = 0;
+    while (maxCount == 0 || count < maxCount) {
+        if (!it->Empty(level)) {
+            extractResult(it, level, recognize, items);
+            ++count;
+        }
+        if (!it->Next(level)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Local<Array> marshalResults(const std::vector<ResultItem> &items)
+{
+    Nan::EscapableHandleScope scope;
+    Local<Array> results = Nan::New<Array>(static_cast<int>(items.size()));
+    for (size_t i = 0; i < items.size(); ++i) {
+        const ResultItem &item = items[i];
+        Local<Object> result = Nan::New<Object>();
+        if (item.hasBox) {
+            // Extract image coordiante box.
+            Handle<Object> box = Nan::New<Object>();
+            box->Set(Nan::New("x").ToLocalChecked(), Nan::New<Int32>(item.left));
+            box->Set(Nan::New("y").ToLocalChecked(), Nan::New<Int32>(item.top));
+            box->Set(Nan::New("width").ToLocalChecked(), Nan::New<Int32>(item.right - item.left));
+            box->Set(Nan::New("height").ToLocalChecked(), Nan::New<Int32>(item.bottom - item.top));
+            result->Set(Nan::New("box").ToLocalChecked(), box);
+        }
+        if (item.hasText) {
+            result->Set(Nan::New("text").ToLocalChecked(), Nan::New(item.text).ToLocalChecked());
+            result->Set(Nan::New("confidence").ToLocalChecked(), Nan::New<Number>(item.confidence));
+        }
+        if (item.hasChoices) {
+            Local<Array> choices = Nan::New<Array>(static_cast<int>(item.choices.size()));
+            for (size_t j = 0; j < item.choices.size(); ++j) {
+                // Transform choice to object.
+                Local<Object> choice = Nan::New<Object>();
+                choice->Set(Nan::New("text").ToLocalChecked(),
+                            Nan::New<String>(item.choices[j].first).ToLocalChecked());
+                choice->Set(Nan::New("confidence").ToLocalChecked(),
+                            Nan::New<Number>(item.choices[j].second));
+                choices->Set(j, choice);
+            }
+            result->Set(Nan::New("choices").ToLocalChecked(), choices);
+        }
+        results->Set(i, result);
+    }
+    return scope.Escape(results);
+}
+
+// Copies values into a new typed array of type T over its own ArrayBuffer.
+template <typename T, typename V>
+static Local<T> newTypedArray(const std::vector<V> &values)
+{
+    Nan::EscapableHandleScope scope;
+    size_t length = values.size() * sizeof(V);
+    Local<ArrayBuffer> buffer = ArrayBuffer::New(Isolate::GetCurrent(), length);
+    if (length > 0) {
+        memcpy(buffer->GetContents().Data(), values.data(), length);
+    }
+    return scope.Escape(T::New(buffer, 0, values.size()));
+}
+
+// Appends a string to a concatenated UTF-8 column and its end offset.
+static void appendText(const std::string &value, std::string &text, std::vector<int32_t> &offsets)
+{
+    text += value;
+    offsets.push_back(static_cast<int32_t>(text.size()));
+}
+
+Local<Object> marshalColumns(const std::vector<ResultItem> &items, tesseract::PageIteratorLevel level,
+                             bool recognize, const std::vector<int> *parents)
+{
+    Nan::EscapableHandleScope scope;
+    bool hasText = level != tesseract::RIL_TEXTLINE && recognize;
+    bool hasChoices = level == tesseract::RIL_SYMBOL && recognize;
+    std::vector<int32_t> boxes;
+    std::vector<int32_t> textOffsets(1, 0);
+    std::vector<float> confidences;
+    std::vector<int32_t> choiceOffsets(1, 0);
+    std::vector<int32_t> choiceTextOffsets(1, 0);
+    std::vector<float> choiceConfidences;
+    std::string text;
+    std::string choiceText;
+    boxes.reserve(items.size() * 4);
+    for (size_t i = 0; i < items.size(); ++i) {
+        const ResultItem &item = items[i];
+        if (item.hasBox) {
+            boxes.push_back(item.left);
+            boxes.push_back(item.top);
+            boxes.push_back(item.right - item.left);
+            boxes.push_back(item.bottom - item.top);
+        } else {
+            // Keep rows aligned; the object format omits the box instead.
+            boxes.push_back(-1);
+            boxes.push_back(-1);
+            boxes.push_back(0);
+            boxes.push_back(0);
+        }
+        if (hasText) {
+            appendText(item.text, text, textOffsets);
+            confidences.push_back(item.confidence);
+        }
+        if (hasChoices) {
+            for (size_t j = 0; j < item.choices.size(); ++j) {
+                appendText(item.choices[j].first, choiceText, choiceTextOffsets);
+                choiceConfidences.push_back(item.choices[j].second);
+            }
+            choiceOffsets.push_back(static_cast<int32_t>(choiceConfidences.size()));
+        }
+    }
+    Local<Object> result = Nan::New<Object>();
+    result->Set(Nan::New("count").ToLocalChecked(), Nan::New<Int32>(static_cast<int>(items.size())));
+    result->Set(Nan::New("boxes").ToLocalChecked(), newTypedArray<Int32Array>(boxes));
+    if (hasText) {
+        result->Set(Nan::New("text").ToLocalChecked(),
+                    Nan::CopyBuffer(text.data(), static_cast<uint32_t>(text.size())).ToLocalChecked());
+        result->Set(Nan::New("textOffsets").ToLocalChecked(), newTypedArray<Int32Array>(textOffsets));
+        result->Set(Nan::New("confidences").ToLocalChecked(), newTypedArray<Float32Array>(confidences));
+    }
+    if (hasChoices) {
+        Local<Object> choices = Nan::New<Object>();
+        choices->Set(Nan::New("text").ToLocalChecked(),
+                     Nan::CopyBuffer(choiceText.data(), static_cast<uint32_t>(choiceText.size())).ToLocalChecked());
+        choices->Set(Nan::New("textOffsets").ToLocalChecked(), newTypedArray<Int32Array>(choiceTextOffsets));
+        choices->Set(Nan::New("confidences").ToLocalChecked(), newTypedArray<Float32Array>(choiceConfidences));
+        result->Set(Nan::New("choiceOffsets").ToLocalChecked(), newTypedArray<Int32Array>(choiceOffsets));
+        result->Set(Nan::New("choices").ToLocalChecked(), choices);
+    }
+    if (parents) {
+        result->Set(Nan::New("parents").ToLocalChecked(), newTypedArray<Int32Array>(*parents));
+    }
+    return scope.Escape(result);
+}
+
+Local<Value> marshalItems(const std::vector<ResultItem> &items, tesseract::PageIteratorLevel level,
+                          bool recognize, bool columnar)
+{
+    Nan::EscapableHandleScope scope;
+    if (columnar) {
+        return scope.Escape(marshalColumns(items, level, recognize, NULL));
+    }
+    return scope.Escape(marshalResults(items));
+}
+
+Local<Value> transformResult(tesseract::PageIterator *it, tesseract::PageIteratorLevel level,
+                             bool recognize, bool columnar)
+{
+    Nan::EscapableHandleScope scope;
+    std::vector<ResultItem> items;
+    extractResults(it, level, recognize, 0, items);
+    return scope.Escape(marshalItems(items, level, recognize, columnar));
+}
+
+bool toResultFormat(Local<Object> options, bool *columnar)
+{
+    Local<Value> format = Nan::Get(options, Nan::New("format").ToLocalChecked()).ToLocalChecked();
+    if (format->IsUndefined()) {
+        return true;
+    }
+    if (!format->IsString()) {
+        return false;
+    }
+    String::Utf8Value name(format);
+    if (strcmp("objects", *name) != 0 && strcmp("columnar", *name) != 0) {
+        return false;
+    }
+    *columnar = strcmp("columnar", *name) == 0;
+    return true;
+}
+
+// Results of several levels of a page. The parent of an item is the index
+// of the item containing it at the next coarser level requested, or -1.
+struct LevelResults
+{
+    std::vector<std::string> names;
+    std::vector<tesseract::PageIteratorLevel> levels;
+    std::vector<std::vector<ResultItem> > items;
+    std::vector<std::vector<int> > parents;
+    // Index of the next coarser level requested, or -1.
+    std::vector<int> parentLevels;
+};
+
+// Parses the {levels: [String], recognize: Boolean} options of results().
+bool toResultLevels(Local<Object> options, LevelResults *results, bool *recognize)
+{
+    Local<Value> levelsValue = Nan::Get(options, Nan::New("levels").ToLocalChecked()).ToLocalChecked();
+    Local<Value> recognizeValue = Nan::Get(options, Nan::New("recognize").ToLocalChecked()).ToLocalChecked();
+    if (!levelsValue->IsArray()) {
+        return false;
+    }
+    Local<Array> array = levelsValue.As<Array>();
+    for (uint32_t i = 0; i < array->Length(); ++i) {
+        Local<Value> name = array->Get(i);
+        tesseract::PageIteratorLevel level;
+        if (!name->IsString() || !toPageIteratorLevel(*String::Utf8Value(name), &level)) {
+            return false;
+        }
+        results->names.push_back(*String::Utf8Value(name));
+        results->levels.push_back(level);
+    }
+    *recognize = recognizeValue->IsUndefined() || recognizeValue->BooleanValue();
+    return !results->levels.empty();
+}
+
+// Extracts all requested levels in one walk over the finest of them. A
+// coarser element is extracted where the walk enters it.
+void extractLevels(tesseract::PageIterator *it, bool recognize, LevelResults &results)
+{
+    const std::vector<tesseract::PageIteratorLevel> &levels = results.levels;
+    size_t count = levels.size();
+    results.items.assign(count, std::vector<ResultItem>());
+    results.parents.assign(count, std::vector<int>());
+    results.parentLevels.assign(count, -1);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < count; ++j) {
+            int parent = results.parentLevels[i];
+            if (levels[j] < levels[i] && (parent < 0 || levels[j] > levels[parent])) {
+                results.parentLevels[i] = static_cast<int>(j);
+            }
+        }
+    }
+    // Coarse to fine, so that parents are extracted before their children.
+    std::vector<size_t> order;
+    for (int level = tesseract::RIL_BLOCK; level <= tesseract::RIL_SYMBOL; ++level) {
+        for (size_t i = 0; i < count; ++i) {
+            if (levels[i] == level) {
+                order.push_back(i);
+            }
+        }
+    }
+    tesseract::PageIteratorLevel finest = levels[order.back()];
+    if (it == NULL) {
+        return;
+    }
+    it->Begin();
+    do {
+        for (size_t k = 0; k < count; ++k) {
+            size_t i = order[k];
+            if ((levels[i] == finest || it->IsAtBeginningOf(levels[i])) && !it->Empty(levels[i])) {
+                extractResult(it, levels[i], recognize, results.items[i]);
+                int parent = results.parentLevels[i];
+                results.parents[i].push_back(parent < 0 ? -1 :
+                        static_cast<int>(results.items[parent].size()) - 1);
+            }
+        }
+    } while (it->Next(finest));
+}
+
+Local<Object> marshalLevels(const LevelResults &results, bool recognize, bool columnar)
+{
+    Nan::EscapableHandleScope scope;
+    Local<Object> object = Nan::New<Object>();
+    for (size_t i = 0; i < results.names.size(); ++i) {
+        Local<Value> value;
+        if (columnar) {
+            bool hasParent = results.parentLevels[i] >= 0;
+            value = marshalColumns(results.items[i], results.levels[i], recognize,
+                                   hasParent ? &results.parents[i] : NULL);
+        } else {
+            value = marshalResults(results.items[i]);
+        }
+        object->Set(Nan::New(results.names[i]).ToLocalChecked(), value);
+    }
+    return scope.Escape(object);
+}
+
+bool toMonitorOptions(Local<Object> options, int *timeout, Nan::Callback **progress)
+{
+    Local<Value> timeoutValue = Nan::Get(options, Nan::New("timeout").ToLocalChecked()).ToLocalChecked();
+    Local<Value> progressValue = Nan::Get(options, Nan::New("progress").ToLocalChecked()).ToLocalChecked();
+    if ((!timeoutValue->IsUndefined() && !timeoutValue->IsNumber())
+            || (!progressValue->IsUndefined() && !progressValue->IsFunction())) {
+        return false;
+    }
+    *timeout = timeoutValue->IsNumber() ? static_cast<int>(ceil(timeoutValue->NumberValue())) : 0;
+    *progress = progressValue->IsFunction() ? new Nan::Callback(progressValue.As<Function>()) : NULL;
+    return true;
+}
+
+const char *toRegions(Local<Value> value, Pix *pix, tesseract::PageSegMode pageSegMode,
+                      const char *whitelist, std::vector<Region> &regions)
+{
+    if (!value->IsArray()) {
+        return "regions must be an Array";
+    }
+    Local<Array> array = value.As<Array>();
+    regions.resize(array->Length());
+    for (uint32_t i = 0; i < array->Length(); ++i) {
+        Region &region = regions[i];
+        Local<Value> item = array->Get(i);
+        if (!item->IsObject()) {
+            return "regions must be of type {box: Object, [pageSegMode: String], [whitelist: String]}";
+        }
+        Local<Object> options = item->ToObject();
+        Local<Value> boxValue = Nan::Get(options, Nan::New("box").ToLocalChecked()).ToLocalChecked();
+        Local<Value> modeValue = Nan::Get(options, Nan::New("pageSegMode").ToLocalChecked()).ToLocalChecked();
+        Local<Value> whitelistValue = Nan::Get(options, Nan::New("whitelist").ToLocalChecked()).ToLocalChecked();
+        if (!boxValue->IsObject()) {
+            return "region box must be of type Object with x, y, width and height properties";
+        }
+        Local<Object> box = boxValue->ToObject();
+        int x = floor(Nan::Get(box, Nan::New("x").ToLocalChecked()).ToLocalChecked()->NumberValue());
+        int y = floor(Nan::Get(box, Nan::New("y").ToLocalChecked()).ToLocalChecked()->NumberValue());
+        int width = ceil(Nan::Get(box, Nan::New("width").ToLocalChecked()).ToLocalChecked()->NumberValue());
+        int height = ceil(Nan::Get(box, Nan::New("height").ToLocalChecked()).ToLocalChecked()->NumberValue());
+        // WORKAROUND: clamp rectangle to prevent occasional crashes.
+        region.x = (std::max)(x, 0);
+        region.y = (std::max)(y, 0);
+        region.width = (std::min)(width, (int)pix->w - region.x);
+        region.height = (std::min)(height, (int)pix->h - region.y);
+        region.pageSegMode = pageSegMode;
+        if (!modeValue->IsUndefined() && !toPageSegMode(*String::Utf8Value(modeValue), &region.pageSegMode)) {
+            return "region pageSegMode must be one of: "
+                   "osd_only, auto_osd, auto_only, auto, single_column, "
+                   "single_block_vert_text, single_block, single_line, "
+                   "single_word, circle_word, single_char, sparse_text, "
+                   "sparse_text_osd";
+        }
+        if (whitelistValue->IsUndefined()) {
+            region.whitelist = whitelist;
+        } else if (whitelistValue->IsString()) {
+            region.whitelist = *String::Utf8Value(whitelistValue);
+        } else {
+            return "region whitelist must be of type String";
+        }
+    }
+    return NULL;
+}
+
+const char *toRegionOptions(Local<Object> options, bool *hasLevel, tesseract::PageIteratorLevel *level,
+                            int *timeout, Nan::Callback **progress)
+{
+    Local<Value> levelValue = Nan::Get(options, Nan::New("level").ToLocalChecked()).ToLocalChecked();
+    if (!levelValue->IsUndefined()) {
+        if (!toPageIteratorLevel(*String::Utf8Value(levelValue), level)) {
+            return "level must be one of: region, paragraph, textline, word, symbol";
+        }
+        *hasLevel = true;
+    }
+    if (!toMonitorOptions(options, timeout, progress)) {
+        return "expected options {timeout: Number, progress: Function}";
+    }
+    return NULL;
+}
+
+Pix *thresholdPage(Pix *pix)
+{
+    tesseract::ImageThresholder thresholder;
+    thresholder.SetImage(pix);
+    Pix *binary = NULL;
+    thresholder.ThresholdToPix(tesseract::PSM_AUTO, &binary);
+    if (binary) {
+        pixCopyResolution(binary, pix);
+    }
+    return binary;
+}
+
+bool recognizeRegion(tesseract::TessBaseAPI &api, const Region &region, ETEXT_DESC *monitor,
+                     const tesseract::PageIteratorLevel *level, RegionResult &result)
+{
+    result.confidence = 0;
+    if (region.width <= 0 || region.height <= 0) {
+        return true;
+    }
+    api.SetPageSegMode(region.pageSegMode);
+    api.SetVariable("tessedit_char_whitelist", region.whitelist.c_str());
+    api.SetRectangle(region.x, region.y, region.width, region.height);
+    if (api.Recognize(monitor) != 0) {
+        return false;
+    }
+    char *text = api.GetUTF8Text();
+    if (text) {
+        result.text = text;
+        delete[] text;
+    }
+    result.confidence = api.MeanTextConf();
+    if (level) {
+        tesseract::PageIterator *it = api.GetIterator();
+        extractResults(it, *level, true, 0, result.items);
+        delete it;
+    }
+    return true;
+}
+
+Local<Array> marshalRegions(const std::vector<RegionResult> &results, bool hasLevel)
+{
+    Nan::EscapableHandleScope scope;
+    Local<Array> array = Nan::New<Array>(static_cast<int>(results.size()));
+    for (size_t i = 0; i < results.size(); ++i) {
+        Local<Object> result = Nan::New<Object>();
+        result->Set(Nan::New("text").ToLocalChecked(), Nan::New(results[i].text).ToLocalChecked());
+        result->Set(Nan::New("confidence").ToLocalChecked(), Nan::New<Number>(results[i].confidence));
+        if (hasLevel) {
+            result->Set(Nan::New("results").ToLocalChecked(), marshalResults(results[i].items));
+        }
+        array->Set(i, result);
+    }
+    return scope.Escape(array);
+}
+
+JobMonitor::JobMonitor(int timeout)
+    : cancelled_(false), timeout_(timeout), started_(false), reported_(0), progress_(NULL)
+{
+    desc_.cancel = CancelFunc;
+    desc_.cancel_this = this;
+}
+
+ETEXT_DESC *JobMonitor::Start(const Nan::AsyncProgressWorker::ExecutionProgress *progress)
+{
+    progress_ = progress;
+    if (started_) {
+        desc_.progress = 0;
+        reported_ = 0;
+    } else if (timeout_ > 0) {
+        desc_.set_deadline_msecs(timeout_);
+    }
+    started_ = true;
+    return &desc_;
+}
+
+void JobMonitor::Cancel()
+{
+    cancelled_ = true;
+}
+
+bool JobMonitor::Cancelled() const
+{
+    return cancelled_;
+}
+
+bool JobMonitor::TimedOut() const
+{
+    return timeout_ > 0 && desc_.deadline_exceeded();
+}
+
+Local<Value> JobMonitor::Error(const char *message) const
+{
+    Nan::EscapableHandleScope scope;
+    const char *code = NULL;
+    if (cancelled_) {
+        message = "Recognition cancelled";
+        code = "ECANCELED";
+    } else if (TimedOut()) {
+        message = "Recognition timed out";
+        code = "ETIMEDOUT";
+    }
+    Local<Value> error = Nan::Error(message);
+    if (code) {
+        error.As<Object>()->Set(Nan::New("code").ToLocalChecked(), Nan::New(code).ToLocalChecked());
+    }
+    return scope.Escape(error);
+}
+
+// Called by Tesseract after each word, right after updating the progress.
+bool JobMonitor::CancelFunc(void *data, int words)
+{
+    JobMonitor *monitor = static_cast<JobMonitor*>(data);
+    if (monitor->progress_ && monitor->desc_.progress > monitor->reported_) {
+        monitor->reported_ = monitor->desc_.progress;
+        char percent = static_cast<char>(monitor->reported_);
+        monitor->progress_->Send(&percent, 1);
+    }
+    return monitor->cancelled_;
+}
+
+int TesseractAPI::PageMemorySize() const
+{
+    if (!tesseract_) {
+        return 0;
+    }
+    return pixMemorySize(tesseract_->pix_binary())
+            + pixMemorySize(tesseract_->pix_grey());
+}
+
+bool TesseractAPI::GetRectangle(int *left, int *top, int *width, int *height)
+{
+    if (!thresholder_ || thresholder_->IsEmpty()) {
+        return false;
+    }
+    int imageWidth, imageHeight;
+    thresholder_->GetImageSizes(left, top, width, height, &imageWidth, &imageHeight);
+    return *width != imageWidth || *height != imageHeight;
+}
+
+// Runs a job on a libuv worker thread. The Tesseract instance is locked
+// against concurrent use until the job completes on the main thread.
+class TesseractWorker : public Nan::AsyncProgressWorker
+{
+public:
+    TesseractWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback,
+                    int timeout, Nan::Callback *progress)
+        : Nan::AsyncProgressWorker(callback), obj_(obj), monitor_(timeout),
+          progress_(progress)
+    {
+        SaveToPersistent("self", self);
+        obj_->busy_ = true;
+        obj_->monitor_ = &monitor_;
+    }
+
+    ~TesseractWorker()
+    {
+        delete progress_;
+    }
+
+    void WorkComplete()
+    {
+        obj_->busy_ = false;
+        obj_->monitor_ = NULL;
+        obj_->Account();
+        Nan::AsyncProgressWorker::WorkComplete();
+    }
+
+    void HandleProgressCallback(const char *data, size_t count)
+    {
+        if (!progress_ || count == 0) {
+            return;
+        }
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { Nan::New<Int32>(data[0]) };
+        progress_->Call(1, argv, async_resource);
+    }
+
+    void HandleErrorCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { monitor_.Error(ErrorMessage()) };
+        callback->Call(1, argv, async_resource);
+    }
+
+protected:
+    TesseractAPI &api()
+    {
+        return obj_->api_;
+    }
+
+    // Recognizes the page under the job's monitor, unless its results are
+    // still cached. A cancelled or timed out page is discarded.
+    bool Recognize(const ExecutionProgress &progress)
+    {
+        if (monitor_.Cancelled()) {
+            SetErrorMessage("Recognition cancelled");
+            return false;
+        }
+        if (!obj_->RecognizePage(monitor_.Start(progress_ ? &progress : NULL))) {
+            SetErrorMessage("Internal tesseract error");
+            return false;
+        }
+        return true;
+    }
+
+    // Recognizes the page if requested and returns an iterator over it.
+    // Without recognition, a cached page is reused before analysing the
+    // layout.
+    bool Iterator(const ExecutionProgress &progress, bool recognize,
+                  tesseract::PageIterator **it)
+    {
+        if (recognize) {
+            if (!Recognize(progress)) {
+                return false;
+            }
+        } else if (monitor_.Cancelled()) {
+            SetErrorMessage("Recognition cancelled");
+            return false;
+        }
+        *it = obj_->GetIterator();
+        return true;
+    }
+
+    JobMonitor monitor_;
+
+private:
+    Tesseract *obj_;
+    Nan::Callback *progress_;
+};
+
+class FindWorker : public TesseractWorker
+{
+public:
+    FindWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback,
+               int timeout, Nan::Callback *progress,
+               tesseract::PageIteratorLevel level, bool recognize, bool columnar)
+        : TesseractWorker(obj, self, callback, timeout, progress), level_(level),
+          recognize_(recognize), columnar_(columnar)
+    {
+    }
+
+    void Execute(const ExecutionProgress &progress)
+    {
+        tesseract::PageIterator *it = NULL;
+        if (Iterator(progress, recognize_, &it)) {
+            extractResults(it, level_, recognize_, 0, items_);
+            delete it;
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { Nan::Null(), marshalItems(items_, level_, recognize_, columnar_) };
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    tesseract::PageIteratorLevel level_;
+    bool recognize_;
+    bool columnar_;
+    std::vector<ResultItem> items_;
+};
+
+class FindTextWorker : public TesseractWorker
+{
+public:
+    FindTextWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback,
+                   int timeout, Nan::Callback *progress,
+                   TextMode mode, int pageNumber, bool withConfidence)
+        : TesseractWorker(obj, self, callback, timeout, progress), mode_(mode),
+          pageNumber_(pageNumber), withConfidence_(withConfidence), confidence_(0)
+    {
+    }
+
+    void Execute(const ExecutionProgress &progress)
+    {
+        if (!Recognize(progress)) {
+            return;
+        }
+        char *text = getText(api(), mode_, pageNumber_);
+        if (!text) {
+            return SetErrorMessage("Internal tesseract error");
+        }
+        text_ = text;
+        delete[] text;
+        if (withConfidence_) {
+            confidence_ = api().MeanTextConf();
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { Nan::Null(), Nan::New(text_).ToLocalChecked() };
+        if (withConfidence_) {
+            Local<Object> result = Nan::New<Object>();
+            result->Set(Nan::New("text").ToLocalChecked(), argv[1]);
+            result->Set(Nan::New("confidence").ToLocalChecked(), Nan::New<Number>(confidence_));
+            argv[1] = result;
+        }
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    TextMode mode_;
+    int pageNumber_;
+    bool withConfidence_;
+    std::string text_;
+    int confidence_;
+};
+
+class RecognizeWorker : public TesseractWorker
+{
+public:
+    RecognizeWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback,
+                    int timeout, Nan::Callback *progress)
+        : TesseractWorker(obj, self, callback, timeout, progress)
+    {
+    }
+
+    void Execute(const ExecutionProgress &progress)
+    {
+        Recognize(progress);
+    }
+};
+
+// Extracts several levels from a single recognition of the page.
+class ResultsWorker : public TesseractWorker
+{
+public:
+    ResultsWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback,
+                  int timeout, Nan::Callback *progress,
+                  const LevelResults &results, bool recognize, bool columnar)
+        : TesseractWorker(obj, self, callback, timeout, progress), results_(results),
+          recognize_(recognize), columnar_(columnar)
+    {
+    }
+
+    void Execute(const ExecutionProgress &progress)
+    {
+        tesseract::PageIterator *it = NULL;
+        if (Iterator(progress, recognize_, &it)) {
+            extractLevels(it, recognize_, results_);
+            delete it;
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { Nan::Null(), marshalLevels(results_, recognize_, columnar_) };
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    LevelResults results_;
+    bool recognize_;
+    bool columnar_;
+};
+
+// Recognizes regions one after another on a binarized copy of the page,
+// restoring the image, rectangle, mode and whitelist of the instance after.
+class RegionsWorker : public TesseractWorker
+{
+public:
+    RegionsWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback,
+                  int timeout, Nan::Callback *progress, Pix *page,
+                  const std::vector<Region> &regions, bool hasLevel,
+                  tesseract::PageIteratorLevel level)
+        : TesseractWorker(obj, self, callback, timeout, progress), page_(page),
+          regions_(regions), results_(regions.size()), hasLevel_(hasLevel), level_(level)
+    {
+    }
+
+    ~RegionsWorker()
+    {
+        pixDestroy(&page_);
+    }
+
+    void Execute(const ExecutionProgress &progress)
+    {
+        Pix *binary = thresholdPage(page_);
+        if (!binary) {
+            return SetErrorMessage("Internal tesseract error");
+        }
+        TesseractAPI &tess = api();
+        int left, top, width, height;
+        bool hasRectangle = tess.GetRectangle(&left, &top, &width, &height);
+        tesseract::PageSegMode pageSegMode = tess.GetPageSegMode();
+        const char *whitelistValue = tess.GetStringVariable("tessedit_char_whitelist");
+        std::string whitelist = whitelistValue ? whitelistValue : "";
+        tess.SetImage(binary);
+        pixDestroy(&binary);
+        for (size_t i = 0; i < regions_.size(); ++i) {
+            if (monitor_.Cancelled()) {
+                SetErrorMessage("Recognition cancelled");
+                break;
+            }
+            if (monitor_.TimedOut()) {
+                SetErrorMessage("Recognition timed out");
+                break;
+            }
+            if (!recognizeRegion(tess, regions_[i], monitor_.Start(NULL),
+                                 hasLevel_ ? &level_ : NULL, results_[i])) {
+                SetErrorMessage("Internal tesseract error");
+                break;
+            }
+            char percent = static_cast<char>(100 * (i + 1) / regions_.size());
+            progress.Send(&percent, 1);
+        }
+        tess.SetPageSegMode(pageSegMode);
+        tess.SetVariable("tessedit_char_whitelist", whitelist.c_str());
+        tess.SetImage(page_);
+        if (hasRectangle) {
+            tess.SetRectangle(left, top, width, height);
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { Nan::Null(), marshalRegions(results_, hasLevel_) };
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    Pix *page_;
+    std::vector<Region> regions_;
+    std::vector<RegionResult> results_;
+    bool hasLevel_;
+    tesseract::PageIteratorLevel level_;
+};
+
+// Recognizes the page and keeps the iterator on the Tesseract instance, so
+// that results can be fetched chunk by chunk.
+class IterateWorker : public TesseractWorker
+{
+public:
+    IterateWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback,
+                  int timeout, Nan::Callback *progress,
+                  tesseract::PageIteratorLevel level, bool recognize)
+        : TesseractWorker(obj, self, callback, timeout, progress), obj_(obj),
+          level_(level), recognize_(recognize), it_(NULL)
+    {
+    }
+
+    ~IterateWorker()
+    {
+        delete it_;
+    }
+
+    void Execute(const ExecutionProgress &progress)
+    {
+        Iterator(progress, recognize_, &it_);
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        if (it_) {
+            obj_->iterator_ = it_;
+            obj_->iteratorLevel_ = level_;
+            obj_->iteratorRecognize_ = recognize_;
+            obj_->busy_ = true;
+            it_ = NULL;
+        }
+        Local<Value> argv[] = { Nan::Null(), Nan::New(obj_->iterator_ != NULL) };
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    Tesseract *obj_;
+    tesseract::PageIteratorLevel level_;
+    bool recognize_;
+    tesseract::PageIterator *it_;
+};
+
+// Extracts the next chunk of results on a worker thread.
+class ChunkWorker : public Nan::AsyncWorker
+{
+public:
+    ChunkWorker(Tesseract *obj, Local<Object> self, Nan::Callback *callback, size_t count)
+        : Nan::AsyncWorker(callback), obj_(obj), count_(count), more_(false)
+    {
+        SaveToPersistent("self", self);
+        obj_->fetching_ = true;
+    }
+
+    void Execute()
+    {
+        more_ = extractResults(obj_->iterator_, obj_->iteratorLevel_,
+                               obj_->iteratorRecognize_, count_, items_);
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        obj_->fetching_ = false;
+        if (!more_ || obj_->closing_) {
+            obj_->EndIterate();
+        }
+        Local<Value> argv[] = { Nan::Null(), marshalResults(items_), Nan::New(!more_) };
+        items_.clear();
+        callback->Call(3, argv, async_resource);
+    }
+
+private:
+    Tesseract *obj_;
+    size_t count_;
+    bool more_;
+    std::vector<ResultItem> items_;
+};
 
 NAN_MODULE_INIT(Tesseract::Init)
 {
@@ -70,7 +1115,24 @@ NAN_MODULE_INIT(Tesseract::Init)
     Nan::SetPrototypeMethod(constructor_template, "findWords", FindWords);
     Nan::SetPrototypeMethod(constructor_template, "findSymbols", FindSymbols);
     Nan::SetPrototypeMethod(constructor_template, "findText", FindText);
+    Nan::SetPrototypeMethod(constructor_template, "recognize", Recognize);
+    Nan::SetPrototypeMethod(constructor_template, "results", Results);
+    Nan::SetPrototypeMethod(constructor_template, "findRegionsAsync", FindRegionsAsync);
+    Nan::SetPrototypeMethod(constructor_template, "findParagraphsAsync", FindParagraphsAsync);
+    Nan::SetPrototypeMethod(constructor_template, "findTextLinesAsync", FindTextLinesAsync);
+    Nan::SetPrototypeMethod(constructor_template, "findWordsAsync", FindWordsAsync);
+    Nan::SetPrototypeMethod(constructor_template, "findSymbolsAsync", FindSymbolsAsync);
+    Nan::SetPrototypeMethod(constructor_template, "findTextAsync", FindTextAsync);
+    Nan::SetPrototypeMethod(constructor_template, "recognizeAsync", RecognizeAsync);
+    Nan::SetPrototypeMethod(constructor_template, "resultsAsync", ResultsAsync);
+    Nan::SetPrototypeMethod(constructor_template, "recognizeRegions", RecognizeRegions);
+    Nan::SetPrototypeMethod(constructor_template, "cancel", Cancel);
+    Nan::SetPrototypeMethod(constructor_template, "iterateBegin", Iterate);
+    Nan::SetPrototypeMethod(constructor_template, "iterateNext", NextResults);
+    Nan::SetPrototypeMethod(constructor_template, "iterateEnd", CloseResults);
     
+    delete tesseract_;
+
     target->Set(Nan::New("Tesseract").ToLocalChecked(), constructor_template->GetFunction());
 }
 
@@ -102,6 +1164,7 @@ NAN_METHOD(Tesseract::New)
         Local<Object> image_ = image->ToObject();
         obj->image_.Reset(image_);
         obj->api_.SetImage(Image::Pixels(image_));
+        obj->Account();
     }
     obj->Wrap(info.This());
 }
@@ -117,10 +1180,12 @@ NAN_SETTER(Tesseract::SetImage)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     if (Image::HasInstance(value) || value->IsNull()) {
         if (!obj->image_.IsEmpty()) {
             obj->image_.Reset();
         }
+        obj->recognized_ = false;
         if (!value->IsNull()) {
             Local<Object> image_ = value->ToObject();
             obj->image_.Reset(image_);
@@ -128,6 +1193,7 @@ NAN_SETTER(Tesseract::SetImage)
         } else {
             obj->api_.Clear();
         }
+        obj->Account();
     } else {
         Nan::ThrowTypeError("value must be of type Image");
     }
@@ -144,6 +1210,7 @@ NAN_SETTER(Tesseract::SetRectangle)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     Local<Object> rect = value->ToObject();
     if (value->IsObject()) {
         if (!obj->rectangle_.IsEmpty()) {
@@ -156,13 +1223,23 @@ NAN_SETTER(Tesseract::SetRectangle)
         int height = ceil(Nan::Get(rect, Nan::New("height").ToLocalChecked()).ToLocalChecked()->NumberValue());
         if (!obj->image_.IsEmpty()) {
             // WORKAROUND: clamp rectangle to prevent occasional crashes.
-            PIX* pix = Image::Pixels(Nan::New<Object>(obj->image_));
+            // The image may have been disposed since, Tesseract keeps a copy.
+            int imageWidth = 0, imageHeight = 0;
+            if (Image::HasInstance(Nan::New<Object>(obj->image_))) {
+                PIX* pix = Image::Pixels(Nan::New<Object>(obj->image_));
+                imageWidth = pix->w;
+                imageHeight = pix->h;
+            } else if (obj->api_.GetInputImage()) {
+                imageWidth = pixGetWidth(obj->api_.GetInputImage());
+                imageHeight = pixGetHeight(obj->api_.GetInputImage());
+            }
             x = (std::max)(x, 0);
             y = (std::max)(y, 0);
-            width = (std::min)(width, (int)pix->w - x);
-            height = (std::min)(height, (int)pix->h - y);
+            width = (std::min)(width, imageWidth - x);
+            height = (std::min)(height, imageHeight - y);
         }
         obj->api_.SetRectangle(x, y, width, height);
+        obj->recognized_ = false;
     } else {
         Nan::ThrowTypeError("value must be of type Object with at least "
               "x, y, width and height properties");
@@ -173,6 +1250,7 @@ NAN_GETTER(Tesseract::GetPageSegMode)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     switch (obj->api_.GetPageSegMode()) {
     case tesseract::PSM_OSD_ONLY:
         ReturnValue("osd_only");
@@ -209,33 +1287,12 @@ NAN_SETTER(Tesseract::SetPageSegMode)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     String::Utf8Value pageSegMode(value);
-    if (strcmp("osd_only", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_OSD_ONLY);
-    } else if (strcmp("auto_osd", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_AUTO_OSD);
-    } else if (strcmp("auto_only", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_AUTO_ONLY);
-    } else if (strcmp("auto", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_AUTO);
-    } else if (strcmp("single_column", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SINGLE_COLUMN);
-    } else if (strcmp("single_block_vert_text", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SINGLE_BLOCK_VERT_TEXT);
-    } else if (strcmp("single_block", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SINGLE_BLOCK);
-    } else if (strcmp("single_line", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SINGLE_LINE);
-    } else if (strcmp("single_word", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SINGLE_WORD);
-    } else if (strcmp("circle_word", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_CIRCLE_WORD);
-    } else if (strcmp("single_char", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SINGLE_CHAR);
-    } else if (strcmp("sparse_text", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SPARSE_TEXT);
-    } else if (strcmp("sparse_text_osd", *pageSegMode) == 0) {
-        obj->api_.SetPageSegMode(tesseract::PSM_SPARSE_TEXT_OSD);
+    tesseract::PageSegMode mode;
+    if (toPageSegMode(*pageSegMode, &mode)) {
+        obj->api_.SetPageSegMode(mode);
+        obj->recognized_ = false;
     } else {
         Nan::ThrowTypeError("value must be of type String. "
               "Valid values are: "
@@ -250,6 +1307,7 @@ NAN_GETTER(Tesseract::GetSymbolWhitelist)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     ReturnValue(obj->api_.GetStringVariable("tessedit_char_whitelist"));
 }
 
@@ -257,9 +1315,11 @@ NAN_SETTER(Tesseract::SetSymbolWhitelist)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     if (value->IsString()) {
         String::Utf8Value whitelist(value);
         obj->api_.SetVariable("tessedit_char_whitelist", *whitelist);
+        obj->recognized_ = false;
     } else {
         Nan::ThrowTypeError("value must be of type string");
     }
@@ -269,15 +1329,18 @@ NAN_SETTER(Tesseract::SetVariable)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     String::Utf8Value name(property);
     String::Utf8Value val(value);
     obj->api_.SetVariable(*name, *val);
+    obj->recognized_ = false;
 }
 
 NAN_GETTER(Tesseract::GetIntVariable)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     String::Utf8Value name(property);
     int value;
     if(obj->api_.GetIntVariable(*name, &value)) {
@@ -292,6 +1355,7 @@ NAN_GETTER(Tesseract::GetBoolVariable)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     String::Utf8Value name(property);
     bool value;
     if (obj->api_.GetBoolVariable(*name, &value)) {
@@ -305,6 +1369,7 @@ NAN_GETTER(Tesseract::GetDoubleVariable)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     String::Utf8Value name(property);
     double value;
     if(obj->api_.GetDoubleVariable(*name, &value)) {
@@ -319,6 +1384,7 @@ NAN_GETTER(Tesseract::GetStringVariable)
 {
     Nan::HandleScope scope;
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     String::Utf8Value name(property);
     const char *p = obj->api_.GetStringVariable(*name);
     if((p != NULL)) {
@@ -332,13 +1398,17 @@ NAN_GETTER(Tesseract::GetStringVariable)
 NAN_METHOD(Tesseract::Clear)
 {
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     obj->api_.Clear();
+    obj->recognized_ = false;
+    obj->Account();
     info.GetReturnValue().Set(info.This());
 }
 
 NAN_METHOD(Tesseract::ClearAdaptiveClassifier)
 {
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     obj->api_.ClearAdaptiveClassifier();
     info.GetReturnValue().Set(info.This());
 }
@@ -346,7 +1416,9 @@ NAN_METHOD(Tesseract::ClearAdaptiveClassifier)
 NAN_METHOD(Tesseract::ThresholdImage)
 {
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
     Pix *pix = obj->api_.GetThresholdedImage();
+    obj->Account();
     if (pix) {
         info.GetReturnValue().Set(Image::New(pix));
     } else {
@@ -387,40 +1459,24 @@ NAN_METHOD(Tesseract::FindSymbols)
 NAN_METHOD(Tesseract::FindText)
 {
     Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
-    if (info.Length() >= 1 && info[0]->IsString()) {
-        String::Utf8Value mode(info[0]);
-        bool withConfidence = false;
-        if (info.Length() == 2 && info[1]->IsBoolean()) {
-            withConfidence = info[1]->BooleanValue();
-        } else if (info.Length() == 3 && info[2]->IsBoolean()) {
-            withConfidence = info[2]->BooleanValue();
-        }
-        const char *text = NULL;
-        bool modeValid = true;
-        if (strcmp("plain", *mode) == 0) {
-            text = obj->api_.GetUTF8Text();
-        } else if (strcmp("unlv", *mode) == 0) {
-            text = obj->api_.GetUNLVText();
-        } else if (strcmp("hocr", *mode) == 0 && info.Length() == 2 && info[1]->IsInt32()) {
-            text = obj->api_.GetHOCRText(info[1]->Int32Value());
-        } else if (strcmp("box", *mode) == 0 && info.Length() == 2 && info[1]->IsInt32()) {
-            text = obj->api_.GetBoxText(info[1]->Int32Value());
+    CheckBusy(obj);
+    TextMode mode;
+    int pageNumber;
+    bool withConfidence;
+    if (toTextMode(info, info.Length(), &mode, &pageNumber, &withConfidence)) {
+        const char *text = obj->RecognizePage(NULL) ? getText(obj->api_, mode, pageNumber) : NULL;
+        obj->Account();
+        if (!text) {
+            return Nan::ThrowError("Internal tesseract error");
+        } else if (withConfidence) {
+            Local<Object> result = Nan::New<Object>();
+            result->Set(Nan::New("text").ToLocalChecked(), Nan::New<String>(text).ToLocalChecked());
+            // Don't "delete[] text;": it breaks Tesseract 3.02 (documentation bug?)
+            result->Set(Nan::New("confidence").ToLocalChecked(), Nan::New<Number>(obj->api_.MeanTextConf()));
+            info.GetReturnValue().Set(result);
+            return;
         } else {
-            modeValid = false;
-        }
-        if (modeValid) {
-            if (!text) {
-                return Nan::ThrowError("Internal tesseract error");
-            } else if (withConfidence) {
-                Local<Object> result = Nan::New<Object>();
-                result->Set(Nan::New("text").ToLocalChecked(), Nan::New<String>(text).ToLocalChecked());
-                // Don't "delete[] text;": it breaks Tesseract 3.02 (documentation bug?)
-                result->Set(Nan::New("confidence").ToLocalChecked(), Nan::New<Number>(obj->api_.MeanTextConf()));
-                info.GetReturnValue().Set(result);
-                return;
-            } else {
-                ReturnValue(text);
-            }
+            ReturnValue(text);
         }
     }
     return Nan::ThrowTypeError("cannot convert argument list to "
@@ -430,94 +1486,367 @@ NAN_METHOD(Tesseract::FindText)
                  "(\"box\", pageNumber: Int32, [withConfidence])");
 }
 
+NAN_METHOD(Tesseract::Recognize)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
+    bool recognized = obj->RecognizePage(NULL);
+    obj->Account();
+    if (!recognized) {
+        return Nan::ThrowError("Internal tesseract error");
+    }
+    info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(Tesseract::Results)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
+    LevelResults results;
+    bool recognize;
+    bool columnar = false;
+    if (info.Length() != 1 || !info[0]->IsObject()
+            || !toResultLevels(info[0]->ToObject(), &results, &recognize)
+            || !toResultFormat(info[0]->ToObject(), &columnar)) {
+        return Nan::ThrowTypeError("expected options {levels: [String], [recognize: Boolean], "
+                                   "[format: 'objects' | 'columnar']}");
+    }
+    if (recognize && !obj->RecognizePage(NULL)) {
+        obj->Account();
+        return Nan::ThrowError("Internal tesseract error");
+    }
+    tesseract::PageIterator *it = obj->GetIterator();
+    extractLevels(it, recognize, results);
+    delete it;
+    obj->Account();
+    info.GetReturnValue().Set(marshalLevels(results, recognize, columnar));
+}
+
+NAN_METHOD(Tesseract::FindRegionsAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    return obj->TransformResultAsync(tesseract::RIL_BLOCK, info);
+}
+
+NAN_METHOD(Tesseract::FindParagraphsAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    return obj->TransformResultAsync(tesseract::RIL_PARA, info);
+}
+
+NAN_METHOD(Tesseract::FindTextLinesAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    return obj->TransformResultAsync(tesseract::RIL_TEXTLINE, info);
+}
+
+NAN_METHOD(Tesseract::FindWordsAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    return obj->TransformResultAsync(tesseract::RIL_WORD, info);
+}
+
+NAN_METHOD(Tesseract::FindSymbolsAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    return obj->TransformResultAsync(tesseract::RIL_SYMBOL, info);
+}
+
+NAN_METHOD(Tesseract::FindTextAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
+    int argc = info.Length() - 1;
+    int timeout = 0;
+    Nan::Callback *progress = NULL;
+    if (argc >= 2 && info[argc - 1]->IsObject()) {
+        if (!toMonitorOptions(info[argc - 1]->ToObject(), &timeout, &progress)) {
+            return Nan::ThrowTypeError("expected options {timeout: Number, progress: Function}");
+        }
+        --argc;
+    }
+    TextMode mode;
+    int pageNumber;
+    bool withConfidence;
+    if (argc >= 1 && info[info.Length() - 1]->IsFunction()
+            && toTextMode(info, argc, &mode, &pageNumber, &withConfidence)) {
+        Nan::Callback *callback = new Nan::Callback(info[info.Length() - 1].As<Function>());
+        Nan::AsyncQueueWorker(new FindTextWorker(obj, info.This(), callback, timeout, progress,
+                                                 mode, pageNumber, withConfidence));
+        return;
+    }
+    delete progress;
+    return Nan::ThrowTypeError("cannot convert argument list to "
+                 "(\"plain\", [withConfidence], [options], callback: Function) or "
+                 "(\"unlv\", [withConfidence], [options], callback: Function) or "
+                 "(\"hocr\", pageNumber: Int32, [withConfidence], [options], callback: Function) or "
+                 "(\"box\", pageNumber: Int32, [withConfidence], [options], callback: Function)");
+}
+
+NAN_METHOD(Tesseract::RecognizeAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
+    int argc = info.Length() - 1;
+    if (argc < 0 || argc > 1 || !info[argc]->IsFunction()
+            || (argc == 1 && !info[0]->IsObject())) {
+        return Nan::ThrowTypeError("expected ([options: Object], callback: Function)");
+    }
+    int timeout = 0;
+    Nan::Callback *progress = NULL;
+    if (argc == 1 && !toMonitorOptions(info[0]->ToObject(), &timeout, &progress)) {
+        return Nan::ThrowTypeError("expected options {timeout: Number, progress: Function}");
+    }
+    Nan::Callback *callback = new Nan::Callback(info[argc].As<Function>());
+    Nan::AsyncQueueWorker(new RecognizeWorker(obj, info.This(), callback, timeout, progress));
+}
+
+NAN_METHOD(Tesseract::ResultsAsync)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
+    LevelResults results;
+    bool recognize;
+    bool columnar = false;
+    if (info.Length() != 2 || !info[0]->IsObject() || !info[1]->IsFunction()
+            || !toResultLevels(info[0]->ToObject(), &results, &recognize)
+            || !toResultFormat(info[0]->ToObject(), &columnar)) {
+        return Nan::ThrowTypeError("expected (options: Object, callback: Function) with options "
+                                   "{levels: [String], [recognize: Boolean], "
+                                   "[format: 'objects' | 'columnar']}");
+    }
+    int timeout = 0;
+    Nan::Callback *progress = NULL;
+    if (!toMonitorOptions(info[0]->ToObject(), &timeout, &progress)) {
+        return Nan::ThrowTypeError("expected options {timeout: Number, progress: Function}");
+    }
+    Nan::Callback *callback = new Nan::Callback(info[1].As<Function>());
+    Nan::AsyncQueueWorker(new ResultsWorker(obj, info.This(), callback, timeout, progress,
+                                            results, recognize, columnar));
+}
+
+NAN_METHOD(Tesseract::RecognizeRegions)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
+    int argc = info.Length() - 1;
+    if (argc < 1 || argc > 2 || !info[argc]->IsFunction()
+            || (argc == 2 && !info[1]->IsObject() && !info[1]->IsUndefined())) {
+        return Nan::ThrowTypeError("expected (regions: Array, [options: Object], callback: Function)");
+    }
+    Pix *page = obj->api_.GetInputImage();
+    if (!page) {
+        return Nan::ThrowError("image is empty");
+    }
+    std::vector<Region> regions;
+    const char *whitelist = obj->api_.GetStringVariable("tessedit_char_whitelist");
+    const char *error = toRegions(info[0], page, obj->api_.GetPageSegMode(),
+                                  whitelist ? whitelist : "", regions);
+    if (error) {
+        return Nan::ThrowTypeError(error);
+    }
+    bool hasLevel = false;
+    tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
+    int timeout = 0;
+    Nan::Callback *progress = NULL;
+    if (argc == 2 && info[1]->IsObject()) {
+        error = toRegionOptions(info[1]->ToObject(), &hasLevel, &level, &timeout, &progress);
+        if (error) {
+            return Nan::ThrowTypeError(error);
+        }
+    }
+    // The job replaces the page while it runs.
+    obj->recognized_ = false;
+    Nan::Callback *callback = new Nan::Callback(info[argc].As<Function>());
+    Nan::AsyncQueueWorker(new RegionsWorker(obj, info.This(), callback, timeout, progress,
+                                            pixClone(page), regions, hasLevel, level));
+}
+
+NAN_METHOD(Tesseract::Iterate)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    CheckBusy(obj);
+    int argc = info.Length() - 1;
+    tesseract::PageIteratorLevel level;
+    if (argc < 1 || !info[0]->IsString() || !info[argc]->IsFunction()
+            || (argc == 2 && !info[1]->IsObject())
+            || !toPageIteratorLevel(*String::Utf8Value(info[0]), &level)) {
+        return Nan::ThrowTypeError("expected (level: String, [options: Object], callback: Function)");
+    }
+    bool recognize = true;
+    int timeout = 0;
+    Nan::Callback *progress = NULL;
+    if (argc == 2) {
+        Local<Object> options = info[1]->ToObject();
+        Local<Value> recognizeValue = Nan::Get(options, Nan::New("recognize").ToLocalChecked()).ToLocalChecked();
+        if (!recognizeValue->IsUndefined()) {
+            recognize = recognizeValue->BooleanValue();
+        }
+        if (!toMonitorOptions(options, &timeout, &progress)) {
+            return Nan::ThrowTypeError("expected options {timeout: Number, progress: Function}");
+        }
+    }
+    Nan::Callback *callback = new Nan::Callback(info[argc].As<Function>());
+    Nan::AsyncQueueWorker(new IterateWorker(obj, info.This(), callback, timeout, progress,
+                                            level, recognize));
+}
+
+NAN_METHOD(Tesseract::NextResults)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    if (!info[0]->IsInt32() || info[0]->Int32Value() <= 0 || !info[1]->IsFunction()) {
+        return Nan::ThrowTypeError("expected (count: Int32, callback: Function)");
+    }
+    if (!obj->iterator_ || obj->closing_) {
+        return Nan::ThrowError("no results to iterate");
+    }
+    if (obj->fetching_) {
+        return Nan::ThrowError("already fetching results");
+    }
+    Nan::Callback *callback = new Nan::Callback(info[1].As<Function>());
+    Nan::AsyncQueueWorker(new ChunkWorker(obj, info.This(), callback, info[0]->Int32Value()));
+}
+
+NAN_METHOD(Tesseract::CloseResults)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    if (obj->fetching_) {
+        obj->closing_ = true;
+    } else if (obj->iterator_) {
+        obj->EndIterate();
+    }
+}
+
+NAN_METHOD(Tesseract::Cancel)
+{
+    Tesseract* obj = Nan::ObjectWrap::Unwrap<Tesseract>(info.This());
+    if (obj->monitor_) {
+        obj->monitor_->Cancel();
+    }
+    info.GetReturnValue().Set(obj->monitor_ != NULL);
+}
+
 Tesseract::Tesseract(const char *datapath, const char *language)
+    : busy_(false), monitor_(NULL), recognized_(false), iterator_(NULL),
+      iteratorLevel_(tesseract::RIL_WORD), iteratorRecognize_(false),
+      fetching_(false), closing_(false), accounted_(0)
 {
     int res = api_.Init(datapath, language, tesseract::OEM_DEFAULT);
     api_.SetVariable("save_blob_choices", "T");
     assert(res == 0);
+    // The unpacked models take at least as much as their traineddata files.
+    Isolate *isolate = Isolate::GetCurrent();
+    int modelSize = 0;
+    std::stringstream languages(api_.GetInitLanguagesAsString());
+    std::string name;
+    while (std::getline(languages, name, '+')) {
+        struct stat info;
+        std::string path = std::string(api_.GetDatapath()) + name + ".traineddata";
+        if (stat(path.c_str(), &info) == 0 && chargeModel(isolate, path)) {
+            modelSize += static_cast<int>(info.st_size);
+        }
+    }
+    if (modelSize > 0) {
+        Nan::AdjustExternalMemory(modelSize);
+    }
+    Account();
 }
 
 Tesseract::~Tesseract()
 {
+    delete iterator_;
     api_.End();
+    Nan::AdjustExternalMemory(-accounted_);
+}
+
+void Tesseract::Account()
+{
+    int current = api_.PageMemorySize();
+    if (current != accounted_) {
+        Nan::AdjustExternalMemory(current - accounted_);
+        accounted_ = current;
+    }
+}
+
+bool Tesseract::RecognizePage(ETEXT_DESC *monitor)
+{
+    if (!recognized_) {
+        if (api_.Recognize(monitor) != 0) {
+            api_.ClearResults();
+            return false;
+        }
+        recognized_ = true;
+    }
+    return true;
+}
+
+tesseract::PageIterator *Tesseract::GetIterator()
+{
+    if (recognized_) {
+        return api_.GetIterator();
+    }
+    return api_.AnalyseLayout();
+}
+
+void Tesseract::EndIterate()
+{
+    delete iterator_;
+    iterator_ = NULL;
+    busy_ = false;
+    closing_ = false;
+    Account();
 }
 
 Nan::NAN_METHOD_RETURN_TYPE Tesseract::TransformResult(tesseract::PageIteratorLevel level, Nan::NAN_METHOD_ARGS_TYPE args)
 {
     Nan::HandleScope scope;
+    CheckBusy(this);
     bool recognize = true;
     if (args.Length() >= 1 && args[0]->IsBoolean()) {
         recognize = args[0]->BooleanValue();
     }
-    tesseract::PageIterator *it = 0;
-    if (recognize) {
-        if (api_.Recognize(NULL) != 0) {
-            return Nan::ThrowError("Internal tesseract error");
-        }
-        it = api_.GetIterator();
-    } else {
-        it = api_.AnalyseLayout();
+    bool columnar = false;
+    if (args.Length() >= 1 && args[args.Length() - 1]->IsObject()
+            && !toResultFormat(args[args.Length() - 1]->ToObject(), &columnar)) {
+        return Nan::ThrowTypeError("expected options {format: 'objects' | 'columnar'}");
     }
-    Local<Array> results = Nan::New<Array>();
-    if (it == NULL) {
-        args.GetReturnValue().Set(results);
-        return;
+    if (recognize && !RecognizePage(NULL)) {
+        Account();
+        return Nan::ThrowError("Internal tesseract error");
     }
-    int index = 0;
-    do {
-        if (it->Empty(level)) {
-            continue;
-        }
-        Local<Object> result = Nan::New<Object>();
-        int left, top, right, bottom;
-        if (it->BoundingBoxInternal(level, &left, &top, &right, &bottom)) {
-            // Extract image coordiante box.
-            Handle<Object> box = Nan::New<Object>();
-            box->Set(Nan::New("x").ToLocalChecked(), Nan::New<Int32>(left));
-            box->Set(Nan::New("y").ToLocalChecked(), Nan::New<Int32>(top));
-            box->Set(Nan::New("width").ToLocalChecked(), Nan::New<Int32>(right - left));
-            box->Set(Nan::New("height").ToLocalChecked(), Nan::New<Int32>(bottom - top));
-            result->Set(Nan::New("box").ToLocalChecked(), box);
-        }
-        if (level != tesseract::RIL_TEXTLINE && recognize) {
-            // Extract text.
-            char *text = static_cast<tesseract::ResultIterator *>(it)->GetUTF8Text(level);
-            if (text) {
-                result->Set(Nan::New("text").ToLocalChecked(), Nan::New(text).ToLocalChecked());
-                delete[] text;
-                // Extract confidence.
-                float confidence = static_cast<tesseract::ResultIterator *>(it)->Confidence(level);
-                result->Set(Nan::New("confidence").ToLocalChecked(), Nan::New<Number>(confidence));
-            }
-        }
-        if (level == tesseract::RIL_SYMBOL && recognize) {
-            // Extract choices
-            tesseract::ChoiceIterator choiceIt = tesseract::ChoiceIterator(
-                        *static_cast<tesseract::ResultIterator *>(it));
-            Local<Array> choices = Nan::New<Array>();
-            int choiceIndex = 0;
-            do {
-                const char* text = choiceIt.GetUTF8Text();
-                if (!text) {
-                    break;
-                }
-                // Transform choice to object.
-                Local<Object> choice = Nan::New<Object>();
-                choice->Set(Nan::New("text").ToLocalChecked(),
-                            Nan::New<String>(text).ToLocalChecked());
-                choice->Set(Nan::New("confidence").ToLocalChecked(),
-                            Nan::New<Number>(choiceIt.Confidence()));
-                // Append choice to choices list and cleanup.
-                choices->Set(choiceIndex++, choice);
-                // Don't "delete[] text;": it breaks Tesseract 3.02 (documentation bug?)
-            } while (choiceIt.Next());
-            result->Set(Nan::New("choices").ToLocalChecked(), choices);
-        }
-        // Append result.
-        results->Set(index++, result);
-    } while (it->Next(level));
+    tesseract::PageIterator *it = GetIterator();
+    Local<Value> results = transformResult(it, level, recognize, columnar);
     delete it;
+    Account();
     args.GetReturnValue().Set(results);
 }
 
+Nan::NAN_METHOD_RETURN_TYPE Tesseract::TransformResultAsync(tesseract::PageIteratorLevel level, Nan::NAN_METHOD_ARGS_TYPE args)
+{
+    Nan::HandleScope scope;
+    CheckBusy(this);
+    int argc = args.Length() - 1;
+    if (argc < 0 || !args[argc]->IsFunction()) {
+        return Nan::ThrowTypeError("expected ([recognize: Boolean], [options: Object], callback: Function)");
+    }
+    bool recognize = true;
+    if (argc >= 1 && args[0]->IsBoolean()) {
+        recognize = args[0]->BooleanValue();
+    }
+    int timeout = 0;
+    Nan::Callback *progress = NULL;
+    bool columnar = false;
+    if (argc >= 1 && args[argc - 1]->IsObject()) {
+        if (!toResultFormat(args[argc - 1]->ToObject(), &columnar)) {
+            return Nan::ThrowTypeError("expected options {format: 'objects' | 'columnar'}");
+        }
+        if (!toMonitorOptions(args[argc - 1]->ToObject(), &timeout, &progress)) {
+            return Nan::ThrowTypeError("expected options {timeout: Number, progress: Function}");
+        }
+    }
+    Nan::Callback *callback = new Nan::Callback(args[argc].As<Function>());
+    Nan::AsyncQueueWorker(new FindWorker(this, args.This(), callback, timeout, progress,
+                                         level, recognize, columnar));
+}
+
 }
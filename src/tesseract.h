@@ -13,9 +13,153 @@
 #include <v8.h>
 #include <nan.h>
 #include <baseapi.h>
+#include <ocrclass.h>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+#include "util.h"
 
 namespace binding {
 
+bool toPageSegMode(const char *name, tesseract::PageSegMode *mode);
+bool toPageIteratorLevel(const char *name, tesseract::PageIteratorLevel *level);
+
+// A result extracted from a PageIterator. Extraction does not touch V8, so
+// it can run on a worker thread; marshalResults() turns items into objects.
+struct ResultItem
+{
+    bool hasBox;
+    int left;
+    int top;
+    int right;
+    int bottom;
+    bool hasText;
+    std::string text;
+    float confidence;
+    bool hasChoices;
+    std::vector<std::pair<std::string, float> > choices;
+};
+
+// Extracts up to maxCount (0 = all) non-empty results, advancing it.
+// Returns false once the iterator is exhausted.
+bool extractResults(tesseract::PageIterator *it, tesseract::PageIteratorLevel level,
+                    bool recognize, size_t maxCount, std::vector<ResultItem> &items);
+v8::Local<v8::Array> marshalResults(const std::vector<ResultItem> &items);
+// Marshals items column-wise: an Int32Array of [x, y, width, height] boxes
+// ([-1, -1, 0, 0] for items without one) and, with text, one UTF-8 Buffer
+// sliced by an Int32Array of count + 1 offsets plus a Float32Array of
+// confidences. Symbol choices are columns too, sliced per symbol by
+// choiceOffsets. parents may be NULL.
+v8::Local<v8::Object> marshalColumns(const std::vector<ResultItem> &items,
+                                     tesseract::PageIteratorLevel level, bool recognize,
+                                     const std::vector<int> *parents);
+// Marshals items as objects or, if columnar, column-wise.
+v8::Local<v8::Value> marshalItems(const std::vector<ResultItem> &items,
+                                  tesseract::PageIteratorLevel level, bool recognize,
+                                  bool columnar);
+v8::Local<v8::Value> transformResult(tesseract::PageIterator *it, tesseract::PageIteratorLevel level,
+                                     bool recognize, bool columnar = false);
+
+// Parses the {format: 'objects' | 'columnar'} option of result queries.
+bool toResultFormat(v8::Local<v8::Object> options, bool *columnar);
+
+// Parses the {timeout: Number, progress: Function} options of a job.
+bool toMonitorOptions(v8::Local<v8::Object> options, int *timeout, Nan::Callback **progress);
+
+// A field of a page that is recognized on its own.
+struct Region
+{
+    int x;
+    int y;
+    int width;
+    int height;
+    tesseract::PageSegMode pageSegMode;
+    std::string whitelist;
+};
+
+// The text and mean confidence of a region and, if requested, its results
+// at one level.
+struct RegionResult
+{
+    std::string text;
+    int confidence;
+    std::vector<ResultItem> items;
+};
+
+// Parses [{box: {x, y, width, height}, [pageSegMode: String],
+// [whitelist: String]}], clamping boxes to the image. Regions without a mode
+// or whitelist get the given defaults. Returns an error message or NULL.
+const char *toRegions(v8::Local<v8::Value> value, Pix *pix, tesseract::PageSegMode pageSegMode,
+                      const char *whitelist, std::vector<Region> &regions);
+
+// Parses the {level: String, timeout: Number, progress: Function} options of
+// recognizeRegions(). Returns an error message or NULL.
+const char *toRegionOptions(v8::Local<v8::Object> options, bool *hasLevel,
+                            tesseract::PageIteratorLevel *level, int *timeout,
+                            Nan::Callback **progress);
+
+// Binarizes a whole page the way Tesseract would. Recognizing regions of
+// the binary image then only clips it instead of thresholding each region.
+Pix *thresholdPage(Pix *pix);
+
+// Recognizes a region of the binary page set on api. Empty regions are
+// skipped. Returns false if recognition failed or was cancelled.
+bool recognizeRegion(tesseract::TessBaseAPI &api, const Region &region, ETEXT_DESC *monitor,
+                     const tesseract::PageIteratorLevel *level, RegionResult &result);
+v8::Local<v8::Array> marshalRegions(const std::vector<RegionResult> &results, bool hasLevel);
+
+// Progress monitor of a single recognition job. Enforces an optional
+// deadline (in milliseconds, starting with the first recognition), polls a
+// cancellation flag that may be set from the main thread and forwards
+// progress in percent. Tesseract only checks it between words, so layout
+// analysis cannot be interrupted.
+class JobMonitor
+{
+public:
+    explicit JobMonitor(int timeout = 0);
+
+    // Prepares a recognition. Jobs recognizing several regions call it per
+    // region; the deadline is only armed by the first call, so it bounds the
+    // whole job.
+    ETEXT_DESC *Start(const Nan::AsyncProgressWorker::ExecutionProgress *progress);
+    void Cancel();
+    bool Cancelled() const;
+    bool TimedOut() const;
+
+    // Returns the error to report for a failed job.
+    v8::Local<v8::Value> Error(const char *message) const;
+
+private:
+    static bool CancelFunc(void *data, int words);
+
+    ETEXT_DESC desc_;
+    std::atomic<bool> cancelled_;
+    int timeout_;
+    bool started_;
+    int reported_;
+    const Nan::AsyncProgressWorker::ExecutionProgress *progress_;
+};
+
+// Exposes ClearResults(), so that a cancelled recognition does not leave a
+// partial page behind.
+class TesseractAPI : public tesseract::TessBaseAPI
+{
+public:
+    void ClearResults()
+    {
+        tesseract::TessBaseAPI::ClearResults();
+    }
+
+    // Returns the bytes held for the grey and binarized versions of the
+    // current page. The input image is charged by its Image.
+    int PageMemorySize() const;
+
+    // Returns the rectangle recognition is restricted to and whether it
+    // is smaller than the image.
+    bool GetRectangle(int *left, int *top, int *width, int *height);
+};
+
 class Tesseract : public Nan::ObjectWrap
 {
 public:
@@ -49,15 +193,62 @@ private:
     static NAN_METHOD(FindWords);
     static NAN_METHOD(FindSymbols);
     static NAN_METHOD(FindText);
+    static NAN_METHOD(Recognize);
+    static NAN_METHOD(Results);
+    static NAN_METHOD(Cancel);
+
+    // Asynchronous methods.
+    static NAN_METHOD(FindRegionsAsync);
+    static NAN_METHOD(FindParagraphsAsync);
+    static NAN_METHOD(FindTextLinesAsync);
+    static NAN_METHOD(FindWordsAsync);
+    static NAN_METHOD(FindSymbolsAsync);
+    static NAN_METHOD(FindTextAsync);
+    static NAN_METHOD(RecognizeAsync);
+    static NAN_METHOD(ResultsAsync);
+    static NAN_METHOD(RecognizeRegions);
+    static NAN_METHOD(Iterate);
+    static NAN_METHOD(NextResults);
+    static NAN_METHOD(CloseResults);
 
     Tesseract(const char *datapath, const char *language);
     ~Tesseract();
 
     Nan::NAN_METHOD_RETURN_TYPE TransformResult(tesseract::PageIteratorLevel level, Nan::NAN_METHOD_ARGS_TYPE args);
+    Nan::NAN_METHOD_RETURN_TYPE TransformResultAsync(tesseract::PageIteratorLevel level, Nan::NAN_METHOD_ARGS_TYPE args);
+
+    // Recognizes the page unless it already was since the image, rectangle
+    // or a variable last changed. A failed page is discarded.
+    bool RecognizePage(ETEXT_DESC *monitor);
+    // Returns an iterator over the recognized page or, if there is none, over
+    // a fresh layout analysis.
+    tesseract::PageIterator *GetIterator();
+
+    // Releases the result iterator and unlocks the instance.
+    void EndIterate();
+    // Reports the language data and page images to V8.
+    void Account();
+
+    friend class TesseractWorker;
+    friend class IterateWorker;
+    friend class ChunkWorker;
 
-    tesseract::TessBaseAPI api_;
+    TesseractAPI api_;
+    // Set while a worker thread owns api_.
+    bool busy_;
+    JobMonitor *monitor_;
+    // Set while api_ holds the recognition of the current page.
+    bool recognized_;
+    // Results being iterated. The instance stays locked until exhausted.
+    tesseract::PageIterator *iterator_;
+    tesseract::PageIteratorLevel iteratorLevel_;
+    bool iteratorRecognize_;
+    bool fetching_;
+    bool closing_;
     Nan::Persistent<v8::Object> image_;
     Nan::Persistent<v8::Object> rectangle_;
+    // Bytes currently reported to V8 as external memory.
+    int accounted_;
 };
 
 }
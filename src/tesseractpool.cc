@@ -0,0 +1,591 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#include "tesseractpool.h"
+#include "tesseract.h"
+#include "image.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <resultiterator.h>
+
+using namespace v8;
+
+namespace binding {
+
+// Regions of one page spread over several engines. Each job of the batch
+// takes the next region until none are left, and the batch completes with
+// its last job. Worker threads only write their own results and the atomics.
+struct RegionBatch
+{
+    Pix *binary;
+    std::vector<Region> regions;
+    std::vector<RegionResult> results;
+    bool hasLevel;
+    tesseract::PageIteratorLevel level;
+    std::atomic<size_t> next;
+    std::atomic<size_t> done;
+    std::atomic<bool> failed;
+    int id;
+    int timeout;
+    // Jobs that have not completed yet.
+    int jobs;
+    bool cancelled;
+    Nan::Persistent<Value> error;
+    Nan::Callback *callback;
+    Nan::Callback *progress;
+};
+
+static void destroyBatch(RegionBatch *batch)
+{
+    pixDestroy(&batch->binary);
+    batch->error.Reset();
+    delete batch->callback;
+    delete batch->progress;
+    delete batch;
+}
+
+struct TesseractJob
+{
+    Pix *pix;
+    tesseract::PageIteratorLevel level;
+    tesseract::PageSegMode pageSegMode;
+    bool recognize;
+    bool columnar;
+    bool hasRectangle;
+    int x;
+    int y;
+    int width;
+    int height;
+    int id;
+    JobMonitor *monitor;
+    Nan::Callback *callback;
+    Nan::Callback *progress;
+    // Keeps the source Image alive, as its data may be borrowed.
+    Nan::Persistent<Object> *image;
+    // Set for the jobs of a recognizeRegions() batch, which share its id.
+    RegionBatch *batch;
+};
+
+static void destroyJob(TesseractJob *job)
+{
+    pixDestroy(&job->pix);
+    job->image->Reset();
+    delete job->image;
+    delete job->monitor;
+    delete job->progress;
+    delete job;
+}
+
+// Runs a job on an engine that was taken from the idle list. The results are
+// extracted on the worker thread; the engine is handed back to the pool on the
+// main thread before they are marshalled.
+class PoolWorker : public Nan::AsyncProgressWorker
+{
+public:
+    PoolWorker(TesseractPool *pool, tesseract::TessBaseAPI *engine, TesseractJob *job)
+        : Nan::AsyncProgressWorker(job->callback), pool_(pool), engine_(engine),
+          job_(job)
+    {
+        SaveToPersistent("pool", pool->handle());
+    }
+
+    ~PoolWorker()
+    {
+        destroyJob(job_);
+    }
+
+    void Execute(const ExecutionProgress &progress)
+    {
+        if (job_->monitor->Cancelled()) {
+            return SetErrorMessage("Recognition cancelled");
+        }
+        if (job_->batch) {
+            return ExecuteBatch(progress);
+        }
+        engine_->SetPageSegMode(job_->pageSegMode);
+        engine_->SetImage(job_->pix);
+        if (job_->hasRectangle) {
+            engine_->SetRectangle(job_->x, job_->y, job_->width, job_->height);
+        }
+        tesseract::PageIterator *it;
+        if (job_->recognize) {
+            ETEXT_DESC *monitor = job_->monitor->Start(job_->progress ? &progress : NULL);
+            if (engine_->Recognize(monitor) != 0) {
+                return SetErrorMessage("Internal tesseract error");
+            }
+            it = engine_->GetIterator();
+        } else {
+            it = engine_->AnalyseLayout();
+        }
+        extractResults(it, job_->level, job_->recognize, 0, items_);
+        delete it;
+    }
+
+    // Recognizes regions of the batch until none are left or a job failed.
+    void ExecuteBatch(const ExecutionProgress &progress)
+    {
+        RegionBatch *batch = job_->batch;
+        engine_->SetImage(batch->binary);
+        for (size_t i = batch->next++; i < batch->regions.size(); i = batch->next++) {
+            if (batch->failed) {
+                // The failed job reports the error.
+                return;
+            }
+            if (job_->monitor->Cancelled()) {
+                batch->failed = true;
+                return SetErrorMessage("Recognition cancelled");
+            }
+            if (job_->monitor->TimedOut()) {
+                batch->failed = true;
+                return SetErrorMessage("Recognition timed out");
+            }
+            if (!recognizeRegion(*engine_, batch->regions[i], job_->monitor->Start(NULL),
+                                 batch->hasLevel ? &batch->level : NULL, batch->results[i])) {
+                batch->failed = true;
+                return SetErrorMessage("Internal tesseract error");
+            }
+            ++batch->done;
+            char percent = 0;
+            progress.Send(&percent, 1);
+        }
+    }
+
+    void HandleProgressCallback(const char *data, size_t count)
+    {
+        Nan::Callback *callback = job_->batch ? job_->batch->progress : job_->progress;
+        if (!callback || count == 0) {
+            return;
+        }
+        Nan::HandleScope scope;
+        int percent = data[0];
+        if (job_->batch) {
+            // Jobs report out of order, so count the regions done so far.
+            percent = static_cast<int>(100 * job_->batch->done / job_->batch->regions.size());
+        }
+        Local<Value> argv[] = { Nan::New<Int32>(percent) };
+        callback->Call(1, argv, async_resource);
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        if (job_->batch) {
+            RegionBatch *batch = job_->batch;
+            Release();
+            pool_->CompleteBatchJob(batch, Local<Value>());
+            return;
+        }
+        Release();
+        Local<Value> argv[] = { Nan::Null(), marshalItems(items_, job_->level, job_->recognize,
+                                                          job_->columnar) };
+        callback->Call(2, argv, async_resource);
+    }
+
+    void HandleErrorCallback()
+    {
+        Nan::HandleScope scope;
+        Release();
+        Local<Value> argv[] = { job_->monitor->Error(ErrorMessage()) };
+        if (job_->batch) {
+            pool_->CompleteBatchJob(job_->batch, argv[0]);
+            return;
+        }
+        callback->Call(1, argv, async_resource);
+    }
+
+private:
+    void Release()
+    {
+        engine_->Clear();
+        if (job_->batch) {
+            engine_->SetVariable("tessedit_char_whitelist", "");
+        }
+        pool_->Release(engine_, job_);
+    }
+
+    TesseractPool *pool_;
+    tesseract::TessBaseAPI *engine_;
+    TesseractJob *job_;
+    std::vector<ResultItem> items_;
+};
+
+// Binarizes the page of a batch once for all of its regions.
+class ThresholdWorker : public Nan::AsyncWorker
+{
+public:
+    ThresholdWorker(TesseractPool *pool, RegionBatch *batch, Local<Object> image, Pix *pix)
+        : Nan::AsyncWorker(NULL), pool_(pool), batch_(batch), pix_(pix)
+    {
+        SaveToPersistent("pool", pool->handle());
+        SaveToPersistent("image", image);
+    }
+
+    ~ThresholdWorker()
+    {
+        pixDestroy(&pix_);
+    }
+
+    void Execute()
+    {
+        batch_->binary = thresholdPage(pix_);
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        pool_->StartBatch(batch_);
+    }
+
+private:
+    TesseractPool *pool_;
+    RegionBatch *batch_;
+    Pix *pix_;
+};
+
+NAN_MODULE_INIT(TesseractPool::Init)
+{
+    auto ctor = Nan::New<v8::FunctionTemplate>(New);
+    auto ctorInst = ctor->InstanceTemplate();
+    auto name = Nan::New("TesseractPool").ToLocalChecked();
+    ctor->SetClassName(name);
+    ctorInst->SetInternalFieldCount(1);
+
+    Nan::SetAccessor(ctorInst, Nan::New("size").ToLocalChecked(), GetSize);
+    Nan::SetAccessor(ctorInst, Nan::New("idle").ToLocalChecked(), GetIdle);
+    Nan::SetAccessor(ctorInst, Nan::New("pending").ToLocalChecked(), GetPending);
+
+    Nan::SetPrototypeMethod(ctor, "recognize", Recognize);
+    Nan::SetPrototypeMethod(ctor, "recognizeRegions", RecognizeRegions);
+    Nan::SetPrototypeMethod(ctor, "cancel", Cancel);
+
+    Nan::Set(target, name, Nan::GetFunction(ctor).ToLocalChecked());
+}
+
+NAN_METHOD(TesseractPool::New)
+{
+    if (info.Length() == 3 && info[0]->IsString() && info[1]->IsString()
+            && info[2]->IsInt32() && info[2]->Int32Value() > 0) {
+        TesseractPool *obj = new TesseractPool(*String::Utf8Value(info[0]),
+                                               *String::Utf8Value(info[1]),
+                                               info[2]->Int32Value());
+        if (static_cast<int>(obj->engines_.size()) != info[2]->Int32Value()) {
+            delete obj;
+            return Nan::ThrowError("error while initializing tesseract");
+        }
+        obj->Wrap(info.This());
+    } else {
+        return Nan::ThrowTypeError("cannot convert argument list to "
+                     "(datapath: String, language: String, size: Int32)");
+    }
+}
+
+NAN_GETTER(TesseractPool::GetSize)
+{
+    TesseractPool *obj = Nan::ObjectWrap::Unwrap<TesseractPool>(info.Holder());
+    info.GetReturnValue().Set(Nan::New(static_cast<int>(obj->engines_.size())));
+}
+
+NAN_GETTER(TesseractPool::GetIdle)
+{
+    TesseractPool *obj = Nan::ObjectWrap::Unwrap<TesseractPool>(info.Holder());
+    info.GetReturnValue().Set(Nan::New(static_cast<int>(obj->idle_.size())));
+}
+
+NAN_GETTER(TesseractPool::GetPending)
+{
+    TesseractPool *obj = Nan::ObjectWrap::Unwrap<TesseractPool>(info.Holder());
+    info.GetReturnValue().Set(Nan::New(static_cast<int>(obj->queue_.size())));
+}
+
+NAN_METHOD(TesseractPool::Recognize)
+{
+    TesseractPool *obj = Nan::ObjectWrap::Unwrap<TesseractPool>(info.This());
+    int argc = info.Length() - 1;
+    if (argc < 1 || !Image::HasInstance(info[0]) || !info[argc]->IsFunction()
+            || (argc == 2 && !info[1]->IsObject() && !info[1]->IsUndefined())) {
+        return Nan::ThrowTypeError("expected (image: Image, [options: Object], "
+                     "callback: Function)");
+    }
+    Pix *pix = Image::Pixels(info[0]->ToObject());
+    TesseractJob job;
+    job.level = tesseract::RIL_WORD;
+    job.pageSegMode = tesseract::PSM_SINGLE_BLOCK; // Tesseract's default.
+    job.recognize = true;
+    job.columnar = false;
+    job.hasRectangle = false;
+    int timeout = 0;
+    job.progress = NULL;
+    if (argc == 2 && info[1]->IsObject()) {
+        Local<Object> options = info[1]->ToObject();
+        Local<Value> level = Nan::Get(options, Nan::New("level").ToLocalChecked()).ToLocalChecked();
+        Local<Value> pageSegMode = Nan::Get(options, Nan::New("pageSegMode").ToLocalChecked()).ToLocalChecked();
+        Local<Value> recognize = Nan::Get(options, Nan::New("recognize").ToLocalChecked()).ToLocalChecked();
+        Local<Value> rectangle = Nan::Get(options, Nan::New("rectangle").ToLocalChecked()).ToLocalChecked();
+        if (!level->IsUndefined() && !toPageIteratorLevel(*String::Utf8Value(level), &job.level)) {
+            return Nan::ThrowTypeError("level must be one of: "
+                         "region, paragraph, textline, word, symbol");
+        }
+        if (!pageSegMode->IsUndefined() && !toPageSegMode(*String::Utf8Value(pageSegMode), &job.pageSegMode)) {
+            return Nan::ThrowTypeError("pageSegMode must be one of: "
+                         "osd_only, auto_osd, auto_only, auto, single_column, "
+                         "single_block_vert_text, single_block, single_line, "
+                         "single_word, circle_word, single_char, sparse_text, "
+                         "sparse_text_osd");
+        }
+        if (!recognize->IsUndefined()) {
+            job.recognize = recognize->BooleanValue();
+        }
+        if (!toResultFormat(options, &job.columnar)) {
+            return Nan::ThrowTypeError("format must be one of: objects, columnar");
+        }
+        if (rectangle->IsObject()) {
+            Local<Object> rect = rectangle->ToObject();
+            int x = floor(Nan::Get(rect, Nan::New("x").ToLocalChecked()).ToLocalChecked()->NumberValue());
+            int y = floor(Nan::Get(rect, Nan::New("y").ToLocalChecked()).ToLocalChecked()->NumberValue());
+            int width = ceil(Nan::Get(rect, Nan::New("width").ToLocalChecked()).ToLocalChecked()->NumberValue());
+            int height = ceil(Nan::Get(rect, Nan::New("height").ToLocalChecked()).ToLocalChecked()->NumberValue());
+            // WORKAROUND: clamp rectangle to prevent occasional crashes.
+            job.x = (std::max)(x, 0);
+            job.y = (std::max)(y, 0);
+            job.width = (std::min)(width, (int)pix->w - job.x);
+            job.height = (std::min)(height, (int)pix->h - job.y);
+            job.hasRectangle = true;
+        }
+        if (!toMonitorOptions(options, &timeout, &job.progress)) {
+            return Nan::ThrowTypeError("expected options {timeout: Number, progress: Function}");
+        }
+    }
+    job.id = ++obj->lastJobId_;
+    job.batch = NULL;
+    job.pix = Image::Share(pix);
+    job.image = new Nan::Persistent<Object>(info[0]->ToObject());
+    job.monitor = new JobMonitor(timeout);
+    job.callback = new Nan::Callback(info[argc].As<Function>());
+    obj->Enqueue(new TesseractJob(job));
+    info.GetReturnValue().Set(job.id);
+}
+
+NAN_METHOD(TesseractPool::RecognizeRegions)
+{
+    TesseractPool *obj = Nan::ObjectWrap::Unwrap<TesseractPool>(info.This());
+    int argc = info.Length() - 1;
+    if (argc < 2 || argc > 3 || !Image::HasInstance(info[0]) || !info[argc]->IsFunction()
+            || (argc == 3 && !info[2]->IsObject() && !info[2]->IsUndefined())) {
+        return Nan::ThrowTypeError("expected (image: Image, regions: Array, [options: Object], "
+                     "callback: Function)");
+    }
+    Pix *pix = Image::Pixels(info[0]->ToObject());
+    std::vector<Region> regions;
+    const char *error = toRegions(info[1], pix, tesseract::PSM_SINGLE_BLOCK, "", regions);
+    if (error) {
+        return Nan::ThrowTypeError(error);
+    }
+    bool hasLevel = false;
+    tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
+    int timeout = 0;
+    Nan::Callback *progress = NULL;
+    if (argc == 3 && info[2]->IsObject()) {
+        error = toRegionOptions(info[2]->ToObject(), &hasLevel, &level, &timeout, &progress);
+        if (error) {
+            return Nan::ThrowTypeError(error);
+        }
+    }
+    RegionBatch *batch = new RegionBatch();
+    batch->binary = NULL;
+    batch->regions.swap(regions);
+    batch->results.resize(batch->regions.size());
+    batch->hasLevel = hasLevel;
+    batch->level = level;
+    batch->next = 0;
+    batch->done = 0;
+    batch->failed = false;
+    batch->id = ++obj->lastJobId_;
+    batch->timeout = timeout;
+    batch->jobs = 0;
+    batch->cancelled = false;
+    batch->callback = new Nan::Callback(info[argc].As<Function>());
+    batch->progress = progress;
+    obj->thresholding_.push_back(batch);
+    Nan::AsyncQueueWorker(new ThresholdWorker(obj, batch, info[0]->ToObject(), Image::Share(pix)));
+    info.GetReturnValue().Set(batch->id);
+}
+
+NAN_METHOD(TesseractPool::Cancel)
+{
+    TesseractPool *obj = Nan::ObjectWrap::Unwrap<TesseractPool>(info.This());
+    if (!info[0]->IsInt32()) {
+        return Nan::ThrowTypeError("expected (job: Int32)");
+    }
+    int id = info[0]->Int32Value();
+    // A batch may be thresholding, running and queued at once.
+    bool found = false;
+    for (size_t i = 0; i < obj->thresholding_.size(); ++i) {
+        if (obj->thresholding_[i]->id == id) {
+            obj->thresholding_[i]->cancelled = true;
+            found = true;
+        }
+    }
+    for (size_t i = 0; i < obj->running_.size(); ++i) {
+        if (obj->running_[i]->id == id) {
+            obj->running_[i]->monitor->Cancel();
+            found = true;
+        }
+    }
+    std::deque<TesseractJob*>::iterator it = obj->queue_.begin();
+    while (it != obj->queue_.end()) {
+        if ((*it)->id == id) {
+            // Never started, so fail it right away.
+            TesseractJob *job = *it;
+            it = obj->queue_.erase(it);
+            obj->FailQueued(job);
+            found = true;
+        } else {
+            ++it;
+        }
+    }
+    info.GetReturnValue().Set(found);
+}
+
+TesseractPool::TesseractPool(const char *datapath, const char *language, int size)
+    : lastJobId_(0)
+{
+    for (int i = 0; i < size; ++i) {
+        tesseract::TessBaseAPI *engine = new tesseract::TessBaseAPI();
+        if (engine->Init(datapath, language, tesseract::OEM_DEFAULT) != 0) {
+            delete engine;
+            break;
+        }
+        engine->SetVariable("save_blob_choices", "T");
+        engines_.push_back(engine);
+        idle_.push_back(engine);
+    }
+}
+
+TesseractPool::~TesseractPool()
+{
+    // Running jobs keep the pool alive, so only queued jobs remain.
+    for (size_t i = 0; i < queue_.size(); ++i) {
+        RegionBatch *batch = queue_[i]->batch;
+        delete queue_[i]->callback;
+        destroyJob(queue_[i]);
+        if (batch && --batch->jobs == 0) {
+            destroyBatch(batch);
+        }
+    }
+    for (size_t i = 0; i < engines_.size(); ++i) {
+        engines_[i]->End();
+        delete engines_[i];
+    }
+}
+
+void TesseractPool::Enqueue(TesseractJob *job)
+{
+    queue_.push_back(job);
+    Dispatch();
+}
+
+void TesseractPool::Release(tesseract::TessBaseAPI *engine, TesseractJob *job)
+{
+    running_.erase(std::find(running_.begin(), running_.end(), job));
+    idle_.push_back(engine);
+    Dispatch();
+}
+
+void TesseractPool::StartBatch(RegionBatch *batch)
+{
+    thresholding_.erase(std::find(thresholding_.begin(), thresholding_.end(), batch));
+    if (batch->cancelled || !batch->binary || batch->regions.empty()) {
+        // Completes right away, cancelled, failed or with no results.
+        batch->jobs = 1;
+        CompleteBatchJob(batch, batch->binary || batch->cancelled
+                                ? Local<Value>() : JobMonitor().Error("Internal tesseract error"));
+        return;
+    }
+    // One job per engine at most; each one takes regions until none are left.
+    batch->jobs = static_cast<int>((std::min)(engines_.size(), batch->regions.size()));
+    for (int i = 0; i < batch->jobs; ++i) {
+        TesseractJob *job = new TesseractJob();
+        job->pix = NULL;
+        job->level = batch->level;
+        job->pageSegMode = tesseract::PSM_SINGLE_BLOCK;
+        job->recognize = true;
+        job->columnar = false;
+        job->hasRectangle = false;
+        job->id = batch->id;
+        job->monitor = new JobMonitor(batch->timeout);
+        job->callback = NULL;
+        job->progress = NULL;
+        job->image = new Nan::Persistent<Object>();
+        job->batch = batch;
+        queue_.push_back(job);
+    }
+    Dispatch();
+}
+
+void TesseractPool::CompleteBatchJob(RegionBatch *batch, Local<Value> error)
+{
+    Nan::HandleScope scope;
+    if (!error.IsEmpty() && batch->error.IsEmpty()) {
+        batch->error.Reset(error);
+    }
+    if (--batch->jobs > 0) {
+        return;
+    }
+    Local<Value> argv[2];
+    int argc = 1;
+    if (batch->cancelled && batch->error.IsEmpty()) {
+        JobMonitor monitor;
+        monitor.Cancel();
+        argv[0] = monitor.Error("Recognition cancelled");
+    } else if (!batch->error.IsEmpty()) {
+        argv[0] = Nan::New(batch->error);
+    } else {
+        argv[0] = Nan::Null();
+        argv[1] = marshalRegions(batch->results, batch->hasLevel);
+        argc = 2;
+    }
+    Nan::Callback *callback = batch->callback;
+    batch->callback = NULL;
+    destroyBatch(batch);
+    Nan::AsyncResource resource("dv:TesseractPool.recognizeRegions");
+    callback->Call(argc, argv, &resource);
+    delete callback;
+}
+
+void TesseractPool::FailQueued(TesseractJob *job)
+{
+    job->monitor->Cancel();
+    Local<Value> error = job->monitor->Error("Recognition cancelled");
+    if (job->batch) {
+        RegionBatch *batch = job->batch;
+        destroyJob(job);
+        CompleteBatchJob(batch, error);
+        return;
+    }
+    Local<Value> argv[] = { error };
+    Nan::Callback *callback = job->callback;
+    destroyJob(job);
+    Nan::AsyncResource resource("dv:TesseractPool.cancel");
+    callback->Call(1, argv, &resource);
+    delete callback;
+}
+
+void TesseractPool::Dispatch()
+{
+    while (!idle_.empty() && !queue_.empty()) {
+        tesseract::TessBaseAPI *engine = idle_.back();
+        idle_.pop_back();
+        TesseractJob *job = queue_.front();
+        queue_.pop_front();
+        running_.push_back(job);
+        Nan::AsyncQueueWorker(new PoolWorker(this, engine, job));
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ * node-dv - Document Vision for node.js
+ *
+ * Copyright (c) 2012 Christoph Schulz
+ * Copyright (c) 2013-2015 creatale GmbH, contributors listed under AUTHORS
+ *
+ * MIT License <https://github.com/creatale/node-dv/blob/master/LICENSE>
+ */
+#ifndef TESSERACTPOOL_H
+#define TESSERACTPOOL_H
+
+#include <node.h>
+#include <v8.h>
+#include <nan.h>
+#include <baseapi.h>
+#include <allheaders.h>
+#include <deque>
+#include <vector>
+#include "util.h"
+
+namespace binding {
+
+struct TesseractJob;
+struct RegionBatch;
+
+// Owns a fixed number of initialized Tesseract engines. Jobs run on idle
+// engines in the libuv threadpool, the rest wait in FIFO order. All queue
+// bookkeeping happens on the main thread.
+class TesseractPool : public Nan::ObjectWrap
+{
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    static NAN_METHOD(New);
+
+    // Accessors.
+    static NAN_GETTER(GetSize);
+    static NAN_GETTER(GetIdle);
+    static NAN_GETTER(GetPending);
+
+    // Methods.
+    static NAN_METHOD(Recognize);
+    static NAN_METHOD(RecognizeRegions);
+    static NAN_METHOD(Cancel);
+
+    TesseractPool(const char *datapath, const char *language, int size);
+    ~TesseractPool();
+
+    void Enqueue(TesseractJob *job);
+    void Release(tesseract::TessBaseAPI *engine, TesseractJob *job);
+    void Dispatch();
+    // Queues the jobs of a thresholded batch.
+    void StartBatch(RegionBatch *batch);
+    // Records a completed job of a batch, finishing it with the last one.
+    void CompleteBatchJob(RegionBatch *batch, v8::Local<v8::Value> error);
+    // Fails a job that never started.
+    void FailQueued(TesseractJob *job);
+
+    friend class PoolWorker;
+    friend class ThresholdWorker;
+
+    std::vector<tesseract::TessBaseAPI*> engines_;
+    std::vector<tesseract::TessBaseAPI*> idle_;
+    std::deque<TesseractJob*> queue_;
+    std::vector<TesseractJob*> running_;
+    // Batches whose page is being thresholded.
+    std::vector<RegionBatch*> thresholding_;
+    int lastJobId_;
+};
+
+}
+
+#endif
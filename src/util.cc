@@ -68,3 +68,19 @@ int toOp(v8::Local<v8::Value> value)
     }
     return result;
 }
+
+int pixMemorySize(Pix *pix)
+{
+    if (!pix) {
+        return 0;
+    }
+    int result = sizeof(Pix) + pixGetWpl(pix) * 4 * pixGetHeight(pix);
+    PixColormap *cmap = pixGetColormap(pix);
+    if (cmap) {
+        result += sizeof(PixColormap) + cmap->nalloc * sizeof(RGBA_QUAD);
+    }
+    if (pixGetText(pix)) {
+        result += strlen(pixGetText(pix)) + 1;
+    }
+    return result;
+}
@@ -13,9 +13,71 @@
 #include <v8.h>
 #include <nan.h>
 #include <allheaders.h>
+#include <map>
+#include <mutex>
+
+// Holds one persistent handle per isolate, so that the addon can be loaded
+// by several worker threads at the same time. Entries are dropped when the
+// owning environment shuts down.
+template <class T>
+class PerIsolate
+{
+public:
+    void Set(v8::Isolate *isolate, v8::Local<T> value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry *&entry = entries_[isolate];
+        if (!entry) {
+            entry = new Entry(this, isolate);
+#if NODE_MODULE_VERSION >= NODE_11_0_MODULE_VERSION
+            node::AddEnvironmentCleanupHook(isolate, Cleanup, entry);
+#endif
+        }
+        entry->handle.Reset(value);
+    }
+
+    v8::Local<T> Get(v8::Isolate *isolate)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        typename std::map<v8::Isolate*, Entry*>::iterator it = entries_.find(isolate);
+        if (it == entries_.end()) {
+            return v8::Local<T>();
+        }
+        return Nan::New(it->second->handle);
+    }
+
+private:
+    struct Entry
+    {
+        Entry(PerIsolate *owner, v8::Isolate *isolate)
+            : owner(owner), isolate(isolate)
+        {
+        }
+
+        PerIsolate *owner;
+        v8::Isolate *isolate;
+        Nan::Persistent<T> handle;
+    };
+
+    static void Cleanup(void *arg)
+    {
+        Entry *entry = static_cast<Entry*>(arg);
+        {
+            std::lock_guard<std::mutex> lock(entry->owner->mutex_);
+            entry->owner->entries_.erase(entry->isolate);
+        }
+        entry->handle.Reset();
+        delete entry;
+    }
+
+    std::mutex mutex_;
+    std::map<v8::Isolate*, Entry*> entries_;
+};
 
 v8::Local<v8::Object> createBox(Box* box);
 Box* toBox(Nan::NAN_METHOD_ARGS_TYPE args, int start, int* end = 0);
 int toOp(v8::Local<v8::Value> value);
+// Returns the bytes allocated for pix: header, data, colormap and text.
+int pixMemorySize(Pix *pix);
 
 #endif
@@ -117,6 +117,96 @@ zxing::Ref<zxing::LuminanceSource> PixSource::crop(int left, int top, int width,
     return zxing::Ref<PixSource>(new PixSource(croppedPix, true));
 }
 
+Local<Object> transformCode(zxing::Ref<zxing::Result> result)
+{
+    Nan::EscapableHandleScope scope;
+    Local<Object> object = Nan::New<Object>();
+    std::string resultStr = result->getText()->getText();
+    object->Set(Nan::New("type").ToLocalChecked(),
+            Nan::New<String>(zxing::BarcodeFormat::barcodeFormatNames[result->getBarcodeFormat()]).ToLocalChecked());
+    object->Set(Nan::New("data").ToLocalChecked(),
+            Nan::New<String>(resultStr).ToLocalChecked());
+		if (result->getBarcodeFormat() == zxing::BarcodeFormat::PDF_417) {
+			object->Set(Nan::New("buffer").ToLocalChecked(),
+					Nan::CopyBuffer((char*)resultStr.data(), resultStr.size()).ToLocalChecked());
+    } else if (result->getRawBytes()) {
+        std::vector<char> resultRawBytes = (*(result->getRawBytes())).values();
+			object->Set(Nan::New("buffer").ToLocalChecked(),
+					Nan::CopyBuffer((char*)resultRawBytes.data(), resultRawBytes.size()).ToLocalChecked());
+    } else {
+			object->Set(Nan::New("buffer").ToLocalChecked(),
+					Nan::NewBuffer(0).ToLocalChecked());
+    }
+    Local<Array> points = Nan::New<Array>();
+    auto strX = Nan::New("x").ToLocalChecked();
+    auto strY = Nan::New("y").ToLocalChecked();
+    for (int i = 0; i < result->getResultPoints()->size(); ++i) {
+        Local<Object> point = Nan::New<Object>();
+        point->Set(strX, Nan::New<Number>(result->getResultPoints()[i]->getX()));
+        point->Set(strY, Nan::New<Number>(result->getResultPoints()[i]->getY()));
+        points->Set(i, point);
+    }
+    object->Set(Nan::New("points").ToLocalChecked(), points);
+    return scope.Escape(object);
+}
+
+// Decodes an image on a worker thread. The hints are copied, so the ZXing
+// instance may be modified while decoding is in progress. Only the Pix handle
+// is pinned, not its pixels: Image methods copy before writing to a Pix that
+// is still referenced here, but writes through pixels() are seen mid-decode.
+class FindCodeWorker : public Nan::AsyncWorker
+{
+public:
+    FindCodeWorker(Local<Object> image, const zxing::DecodeHints &hints, Nan::Callback *callback)
+        : Nan::AsyncWorker(callback), pix_(Image::Share(Image::Pixels(image))), hints_(hints)
+    {
+        SaveToPersistent("image", image);
+    }
+
+    ~FindCodeWorker()
+    {
+        pixDestroy(&pix_);
+    }
+
+    void Execute()
+    {
+        try {
+            zxing::Ref<PixSource> source(new PixSource(pix_));
+            zxing::Ref<zxing::Binarizer> binarizer(new zxing::HybridBinarizer(source));
+            zxing::Ref<zxing::BinaryBitmap> binary(new zxing::BinaryBitmap(binarizer));
+            zxing::Ref<zxing::MultiFormatReader> reader(new zxing::MultiFormatReader);
+            result_ = reader->decode(binary, hints_);
+        } catch (const zxing::ReaderException& e) {
+            if (strcmp(e.what(), "No code detected") != 0) {
+                SetErrorMessage(e.what());
+            }
+        } catch (const zxing::IllegalArgumentException& e) {
+            SetErrorMessage(e.what());
+        } catch (const zxing::Exception& e) {
+            SetErrorMessage(e.what());
+        } catch (const std::exception& e) {
+            SetErrorMessage(e.what());
+        } catch (...) {
+            SetErrorMessage("Uncaught exception");
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+        Local<Value> argv[] = { Nan::Null(), Nan::Null() };
+        if (!result_.empty()) {
+            argv[1] = transformCode(result_);
+        }
+        callback->Call(2, argv, async_resource);
+    }
+
+private:
+    Pix *pix_;
+    zxing::DecodeHints hints_;
+    zxing::Ref<zxing::Result> result_;
+};
+
 const zxing::BarcodeFormat::Value ZXing::BARCODEFORMATS[] = {
     zxing::BarcodeFormat::QR_CODE,
     zxing::BarcodeFormat::DATA_MATRIX,
@@ -149,6 +239,7 @@ NAN_MODULE_INIT(ZXing::Init)
     Nan::SetAccessor(proto, Nan::New("tryHarder").ToLocalChecked(), GetTryHarder, SetTryHarder);
     
     Nan::SetPrototypeMethod(ctor, "findCode", FindCode);
+    Nan::SetPrototypeMethod(ctor, "findCodeAsync", FindCodeAsync);
     Nan::Set(target, name, ctor->GetFunction());
 }
 
@@ -249,40 +340,16 @@ NAN_METHOD(ZXing::FindCode)
     if (obj->image_.IsEmpty()) {
         return Nan::ThrowError("No image set");
     }
+    if (!Image::HasInstance(Nan::New<Object>(obj->image_))) {
+        return Nan::ThrowError("Image is empty or disposed");
+    }
     try {
         Local<Object> image_ = Nan::New<Object>(obj->image_);
         zxing::Ref<PixSource> source(new PixSource(Image::Pixels(image_)));
         zxing::Ref<zxing::Binarizer> binarizer(new zxing::HybridBinarizer(source));
         zxing::Ref<zxing::BinaryBitmap> binary(new zxing::BinaryBitmap(binarizer));
         zxing::Ref<zxing::Result> result(obj->reader_->decode(binary, obj->hints_));
-        Local<Object> object = Nan::New<Object>();
-        std::string resultStr = result->getText()->getText();
-        object->Set(Nan::New("type").ToLocalChecked(),
-                Nan::New<String>(zxing::BarcodeFormat::barcodeFormatNames[result->getBarcodeFormat()]).ToLocalChecked());
-        object->Set(Nan::New("data").ToLocalChecked(),
-                Nan::New<String>(resultStr).ToLocalChecked());
-		if (result->getBarcodeFormat() == zxing::BarcodeFormat::PDF_417) {
-			object->Set(Nan::New("buffer").ToLocalChecked(),
-					Nan::CopyBuffer((char*)resultStr.data(), resultStr.size()).ToLocalChecked());
-        } else if (result->getRawBytes()) {
-            std::vector<char> resultRawBytes = (*(result->getRawBytes())).values();
-			object->Set(Nan::New("buffer").ToLocalChecked(),
-					Nan::CopyBuffer((char*)resultRawBytes.data(), resultRawBytes.size()).ToLocalChecked());
-        } else {
-			object->Set(Nan::New("buffer").ToLocalChecked(),
-					Nan::NewBuffer(0).ToLocalChecked());
-        }
-        Local<Array> points = Nan::New<Array>();
-        auto strX = Nan::New("x").ToLocalChecked();
-        auto strY = Nan::New("y").ToLocalChecked();
-        for (int i = 0; i < result->getResultPoints()->size(); ++i) {
-            Local<Object> point = Nan::New<Object>();
-            point->Set(strX, Nan::New<Number>(result->getResultPoints()[i]->getX()));
-            point->Set(strY, Nan::New<Number>(result->getResultPoints()[i]->getY()));
-            points->Set(i, point);
-        }
-        object->Set(Nan::New("points").ToLocalChecked(), points);
-        info.GetReturnValue().Set(object);
+        info.GetReturnValue().Set(transformCode(result));
     } catch (const zxing::ReaderException& e) {
         if (strcmp(e.what(), "No code detected") == 0) {
             info.GetReturnValue().Set(Nan::Null());
@@ -301,6 +368,22 @@ NAN_METHOD(ZXing::FindCode)
     }
 }
 
+NAN_METHOD(ZXing::FindCodeAsync)
+{
+    ZXing* obj = Nan::ObjectWrap::Unwrap<ZXing>(info.This());
+    if (info.Length() != 1 || !info[0]->IsFunction()) {
+        return Nan::ThrowTypeError("expected (callback: Function)");
+    }
+    if (obj->image_.IsEmpty()) {
+        return Nan::ThrowError("No image set");
+    }
+    if (!Image::HasInstance(Nan::New<Object>(obj->image_))) {
+        return Nan::ThrowError("Image is empty or disposed");
+    }
+    Nan::Callback *callback = new Nan::Callback(info[0].As<Function>());
+    Nan::AsyncQueueWorker(new FindCodeWorker(Nan::New<Object>(obj->image_), obj->hints_, callback));
+}
+
 ZXing::ZXing()
     : hints_(zxing::DecodeHints::DEFAULT_HINT), reader_(new zxing::MultiFormatReader)
 {
@@ -14,6 +14,7 @@
 #include <nan.h>
 #include <zxing/DecodeHints.h>
 #include <zxing/MultiFormatReader.h>
+#include "util.h"
 
 namespace binding {
 
@@ -35,6 +36,7 @@ private:
 
     // Methods.
     static NAN_METHOD(FindCode);
+    static NAN_METHOD(FindCodeAsync);
 
     ZXing();
     ~ZXing();
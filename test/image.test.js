@@ -1,6 +1,7 @@
 global.should = require('chai').should();
 var dv = require('../lib/dv');
 var fs = require('fs');
+var os = require('os');
 
 String.prototype.endsWith = function(suffix) {
     return this.indexOf(suffix, this.length - suffix.length) !== -1;
@@ -66,6 +67,84 @@ describe('Image', function(){
     	image.depth.should.equal(32);
     	image.toBuffer('raw').should.deep.equal(Buffer.from('\x00\x01\x02aaabbb'));
     })
+    it('should construct from raw data of any width', function() {
+        // Widths around the vector kernels' block sizes exercise the tails.
+        [1, 15, 33, 67].forEach(function(width) {
+            var height = 3;
+            var gray = Buffer.alloc(width * height);
+            var rgb = Buffer.alloc(width * height * 3);
+            var rgba = Buffer.alloc(width * height * 4);
+            for (var i = 0; i < width * height; i++) {
+                gray[i] = i * 7;
+                for (var c = 0; c < 4; c++) {
+                    if (c < 3) {
+                        rgb[i * 3 + c] = i * 3 + c;
+                    }
+                    rgba[i * 4 + c] = c < 3 ? i * 3 + c : 255 - i;
+                }
+            }
+            new dv.Image('gray', gray, width, height).toBuffer('raw').should.deep.equal(gray);
+            new dv.Image('rgb', rgb, width, height).toBuffer('raw').should.deep.equal(rgb);
+            new dv.Image('rgba', rgba, width, height).toBuffer('raw').should.deep.equal(rgb);
+        });
+    })
+    it('should wrap raw data without copying', function() {
+        // Rows are passed as 32-bit words in host byte order.
+        var byteOrder = os.endianness();
+        var swap = function(buffer) {
+            return byteOrder === 'LE' ? buffer.swap32() : buffer;
+        };
+        var rgba = swap(Buffer.from(this.rgbaBuffer));
+        var words = Buffer.from(rgba);
+        var copied = new dv.Image('rgba', this.rgbaBuffer, 128, 256);
+        var image = new dv.Image('rgba', rgba, 128, 256, {wrap: true, byteOrder: byteOrder});
+        image.toBuffer('raw').should.deep.equal(copied.toBuffer('raw'));
+        image.pixels().data.should.equal(rgba);
+        rgba.should.deep.equal(words);
+        var gray = swap(Buffer.from('\x00\x01\x02\x04\x05\x06\x07\x08aaaaxxxxbbbbxxxx'));
+        image = new dv.Image('gray', gray, 4, 3, {wrap: true, stride: 8, byteOrder: byteOrder});
+        image.toBuffer('raw').should.deep.equal(Buffer.from('\x00\x01\x02\x04aaaabbbb'));
+        image.toGray().invert().invert().toBuffer('raw').should.deep.equal(image.toBuffer('raw'));
+        (function() {
+            new dv.Image('rgb', Buffer.alloc(12), 2, 2, {wrap: true});
+        }).should.throw(/rgba/);
+        (function() {
+            new dv.Image('gray', Buffer.alloc(12), 3, 4, {wrap: true});
+        }).should.throw(/aligned/);
+        (function() {
+            new dv.Image('rgba', Buffer.alloc(16), 2, 2, {wrap: true, byteOrder: byteOrder === 'LE' ? 'BE' : 'LE'});
+        }).should.throw(/host byte order/);
+    })
+    it('should decode jpg downscaled using {scale}', function(){
+        var jpg = fs.readFileSync(__dirname + '/fixtures/rgb.jpg');
+        var quarter = new dv.Image('jpg', jpg, {scale: 1/4});
+        quarter.width.should.equal(Math.ceil(this.rgb.width / 4));
+        quarter.height.should.equal(Math.ceil(this.rgb.height / 4));
+        quarter.depth.should.equal(32);
+        (function() {
+            new dv.Image('jpg', jpg, {scale: 1/3});
+        }).should.throw(/scale/);
+        (function() {
+            new dv.Image('png', fs.readFileSync(__dirname + '/fixtures/dave.png'), {scale: 1/2});
+        }).should.throw(/only supported for jpg/);
+        return dv.Image.decode('jpg', jpg, {scale: 1/8}).then(function(image){
+            image.width.should.equal(Math.ceil(quarter.width / 2));
+            writeImage('rgb-eighth.png', image);
+        });
+    })
+    it('should decode only the luma channel using {gray}', function(){
+        var jpg = fs.readFileSync(__dirname + '/fixtures/rgb.jpg');
+        var gray = new dv.Image('jpg', jpg, {gray: true});
+        gray.width.should.equal(this.rgb.width);
+        gray.height.should.equal(this.rgb.height);
+        gray.depth.should.equal(8);
+        new dv.Image('png', fs.readFileSync(__dirname + '/fixtures/rgba.png'), {gray: true}).depth.should.equal(8);
+        return dv.Image.decode('jpg', jpg, {gray: true, scale: 1/2}).then(function(image){
+            image.depth.should.equal(8);
+            image.width.should.equal(Math.ceil(gray.width / 2));
+            writeImage('rgb-luma-half.png', image);
+        });
+    })
     it('should save using #toBuffer()', function(){
         writeImage('gray.jpg', this.gray);
         writeImage('rgb.jpg', this.rgb);
@@ -77,6 +156,98 @@ describe('Image', function(){
         writeImage('whd.png', new dv.Image(128, 128, 8));
         writeImage('composed.png', new dv.Image(this.gray, this.textpage, this.textpage));
     })
+    it('should decode asynchronously using Image.decode()', function(){
+        return Promise.all([
+            dv.Image.decode('png', fs.readFileSync(__dirname + '/fixtures/dave.png')),
+            dv.Image.decode('jpg', fs.readFileSync(__dirname + '/fixtures/rgb.jpg'))
+        ]).then(function(images){
+            images[0].depth.should.equal(8);
+            images[1].depth.should.equal(32);
+            writeImage('gray-decode.png', images[0]);
+        });
+    })
+    it('should reject invalid data in Image.decode()', function(){
+        return dv.Image.decode('png', Buffer.from('invalid')).then(function(){
+            throw new Error('expected rejection');
+        }, function(err){
+            err.should.be.an('error');
+        });
+    })
+    it('should encode asynchronously using #toBufferAsync()', function(){
+        var gray = this.gray;
+        return gray.toBufferAsync('png').then(function(buffer){
+            buffer.should.deep.equal(gray.toBuffer('png'));
+            return gray.toBufferAsync('jpg', 50);
+        }).then(function(buffer){
+            buffer.should.deep.equal(gray.toBuffer('jpg', 50));
+        });
+    })
+    it('should encode jpg from any depth', function(){
+        [this.rgb, this.gray, this.gray.threshold(), this.rgb.medianCutQuant(16)].forEach(function(image){
+            var decoded = new dv.Image('jpg', image.toBuffer('jpg', {quality: 80}));
+            decoded.width.should.equal(image.width);
+            decoded.height.should.equal(image.height);
+        });
+    })
+    it('should encode binary images as packed png', function(){
+        [this.gray.threshold(), this.gray.crop(3, 5, 101, 37).threshold()].forEach(function(binary){
+            var png = binary.toBuffer('png');
+            new dv.Image('png', png).toBuffer('raw').should.deep.equal(binary.toBuffer('raw'));
+        });
+    })
+    it('should encode png with compression options', function(){
+        var rgb = this.rgb;
+        var raw = rgb.toBuffer('raw');
+        [{fast: true}, {level: 0}, {level: 9, filter: 'entropy'}, {window: 256, lazy: false, threads: 4}].forEach(function(options){
+            new dv.Image('png', rgb.toBuffer('png', options)).toBuffer('raw').should.deep.equal(raw);
+        });
+        rgb.toBuffer('png', null).should.deep.equal(rgb.toBuffer('png'));
+        rgb.toBuffer('jpg', '90').should.deep.equal(rgb.toBuffer('jpg'));
+        (function() {
+            rgb.toBuffer('png', {level: 10});
+        }).should.throw(/level/);
+        (function() {
+            rgb.toBuffer('png', {filter: 'paeth'});
+        }).should.throw(/filter/);
+        return rgb.toBufferAsync('png', {fast: true, threads: 3}).then(function(buffer){
+            new dv.Image('png', buffer).toBuffer('raw').should.deep.equal(raw);
+        });
+    })
+    it('should run a #pipeline() of ops', function(){
+        var gray = this.gray;
+        return gray.pipeline([
+            {op: 'toGray'},
+            {op: 'otsuAdaptiveThreshold', sx: 16, sy: 16, smoothx: 0, smoothy: 0, scoreFact: 0.1},
+            {op: 'findSkew', output: 'skew'},
+            {op: 'rotate'},
+            {op: 'scale', x: 0.5, output: 'scaled'},
+            {op: 'connectedComponents', connectivity: 8, output: 'components'}
+        ]).then(function(result){
+            result.skew.angle.should.be.closeTo(-0.7, 0.1);
+            result.skew.confidence.should.be.a('number');
+            result.scaled.width.should.equal(Math.round(gray.width / 2));
+            result.components.should.be.an('array');
+            result.should.not.have.property('image');
+            return gray.pipeline([{op: 'invert'}]);
+        }).then(function(image){
+            image.toBuffer().should.deep.equal(gray.invert().toBuffer());
+        });
+    })
+    it('should validate #pipeline() ops', function(){
+        var gray = this.gray;
+        var expectRejection = function(ops, pattern) {
+            return gray.pipeline(ops).then(function(){
+                throw new Error('expected rejection');
+            }, function(err){
+                err.message.should.match(pattern);
+            });
+        };
+        return Promise.all([
+            expectRejection([{op: 'scale'}], /scale/),
+            expectRejection([{op: 'rotate'}], /findSkew/),
+            expectRejection([{op: 'unknown'}], /unknown op/)
+        ]);
+    })
     it('should return raw image data using #toBuffer()', function(){
         var buf = new dv.Image('rgb', this.rgbBuffer, 128, 256).toBuffer();
         buf.length.should.equal(this.rgbBuffer.length);
@@ -84,9 +255,79 @@ describe('Image', function(){
             buf[i].should.equal(this.rgbBuffer[i]);
         }
     })
+    it('should expose pixel memory using #pixels()', function(){
+        var image = new dv.Image(this.gray);
+        var pixels = image.pixels();
+        pixels.depth.should.equal(8);
+        pixels.stride.should.equal(pixels.wpl * 4);
+        pixels.data.length.should.equal(pixels.stride * pixels.height);
+        image.pixels().data.should.equal(pixels.data);
+        var raw = image.toBuffer();
+        var swap = pixels.byteOrder === 'LE' ? 3 : 0;
+        for (var y = 0; y < pixels.height; y += 7) {
+            for (var x = 0; x < pixels.width; x++) {
+                pixels.data[y * pixels.stride + (x ^ swap)].should.equal(raw[y * pixels.width + x]);
+            }
+        }
+        // The buffer aliases the image, so drawing shows up without a copy.
+        image.fillBox(0, 0, 4, 1, 0);
+        pixels.data[0].should.equal(0);
+    })
+    it('should reuse buffers using dv.setPixPool()', function(){
+        dv.setPixPool({sizes: [64 * 64], counts: [4]});
+        try {
+            var image = new dv.Image(64, 64, 8);
+            for (var i = 0; i < 3; i++) {
+                image.erode(3, 3, {inPlace: true});
+            }
+            var stats = dv.pixPoolStats();
+            stats.sizes[0].size.should.equal(64 * 64);
+            stats.misses.should.be.above(0);
+            stats.hits.should.be.above(0);
+            stats.bypassed.should.be.above(0);
+        } finally {
+            dv.setPixPool(null);
+        }
+        dv.pixPoolStats().sizes.should.have.length(0);
+        (function() {
+            dv.setPixPool({sizes: [1024], counts: [1, 2]});
+        }).should.throw(/same length/);
+    })
     it('should #invert()', function(){
         writeImage('gray-invert.png', this.gray.invert());
     })
+    it('should release pixels using #dispose()', function(){
+        var image = new dv.Image(this.gray);
+        var pixels = image.pixels();
+        image.dispose();
+        (image.width === null).should.be.true;
+        (function() {
+            image.invert();
+        }).should.throw(/disposed/);
+        (function() {
+            this.gray.or(image);
+        }).bind(this).should.throw(TypeError);
+        image.dispose();
+        // Buffers from pixels() keep their own reference.
+        pixels.data.length.should.equal(pixels.stride * pixels.height);
+    })
+    it('should apply transforms in place', function(){
+        var image = new dv.Image(this.gray);
+        var snapshot = new dv.Image(image);
+        var expected = image.invert().toBuffer('raw');
+        image.invert({inPlace: true}).should.equal(image);
+        image.toBuffer('raw').should.deep.equal(expected);
+        snapshot.toBuffer('raw').should.not.deep.equal(expected);
+        expected = image.add(snapshot).toBuffer('raw');
+        image.add(snapshot, {inPlace: true}).should.equal(image);
+        image.toBuffer('raw').should.deep.equal(expected);
+        expected = image.threshold().dilate(3, 3).toBuffer('raw');
+        image.threshold({inPlace: true}).dilate(3, 3, {inPlace: true}).should.equal(image);
+        image.depth.should.equal(1);
+        image.toBuffer('raw').should.deep.equal(expected);
+        image.xor(image, {inPlace: true}).toBuffer('raw').should.deep.equal(
+            new dv.Image(image.width, image.height, 1).toBuffer('raw'));
+    })
     it('should #or(), #and(), #xor(), #add() and #subtract()', function(){
         var a = this.gray.otsuAdaptiveThreshold(16, 16, 0, 0, 0.1).image;
         var b = this.gray.erode(5, 5).otsuAdaptiveThreshold(16, 16, 0, 0, 0.1).image;
@@ -263,4 +504,26 @@ describe('Image', function(){
         writeImage('gray-curve.png', new dv.Image(this.gray).applyCurve(curve, mask));
         writeImage('gray-setmasked.png', new dv.Image(this.gray).setMasked(mask, 255));
     })
+    it('should load in worker threads', function(done) {
+        var worker_threads;
+        try {
+            worker_threads = require('worker_threads');
+        } catch (e) {
+            return this.skip();
+        }
+        var source = 'var dv = require(' + JSON.stringify(require.resolve('../lib/dv')) + ');' +
+            'var image = new dv.Image(64, 32, 8);' +
+            'require("worker_threads").parentPort.postMessage(image.width);';
+        var pending = 2;
+        for (var i = 0; i < 2; i++) {
+            var worker = new worker_threads.Worker(source, { eval: true });
+            worker.on('error', done);
+            worker.on('message', function(width) {
+                width.should.equal(64);
+                if (--pending === 0) {
+                    done();
+                }
+            });
+        }
+    })
 })
@@ -0,0 +1,40 @@
+global.should = require('chai').should();
+var dv = require('../lib/dv');
+var fs = require('fs');
+
+describe('PageCache', function(){
+    this.timeout(3000);
+    this.slow(250);
+    before(function(){
+        this.gray = new dv.Image('png', fs.readFileSync(__dirname + '/fixtures/dave.png'));
+        this.rgb = new dv.Image('jpg', fs.readFileSync(__dirname + '/fixtures/rgb.jpg'));
+        this.textpage = new dv.Image('png', fs.readFileSync(__dirname + '/fixtures/textpage300.png'));
+    })
+    it('should round-trip images using #set() and #get()', function(){
+        var cache = new dv.PageCache(64 * 1024 * 1024);
+        var binary = this.textpage.threshold();
+        cache.set('gray', this.gray).set('rgb', this.rgb).set('binary', binary);
+        cache.count.should.equal(3);
+        cache.bytes.should.be.above(0);
+        cache.bytes.should.be.below(this.rgb.width * this.rgb.height * 4);
+        [['gray', this.gray], ['rgb', this.rgb], ['binary', binary]].forEach(function(pair){
+            var image = cache.get(pair[0]);
+            image.depth.should.equal(pair[1].depth);
+            image.toBuffer().should.deep.equal(pair[1].toBuffer());
+        });
+        should.not.exist(cache.get('missing'));
+    })
+    it('should evict the least recently used images', function(){
+        var cache = new dv.PageCache(64 * 1024 * 1024);
+        cache.set('a', this.rgb).set('b', this.gray).set('c', this.textpage);
+        cache.get('a');
+        cache.budget = cache.bytes - 1;
+        cache.has('b').should.be.false;
+        cache.has('a').should.be.true;
+        cache.has('c').should.be.true;
+        cache.delete('a').should.be.true;
+        cache.delete('a').should.be.false;
+        cache.clear().count.should.equal(0);
+        cache.bytes.should.equal(0);
+    })
+})
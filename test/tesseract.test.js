@@ -139,6 +139,137 @@ describe('Tesseract', function(){
         this.tesseract.image = this.textPage300;
         this.tesseract.findText('box', 0).should.have.length.above(100);
     })
+    it('should #findWordsAsync()', function(){
+        this.tesseract.image = this.textPage300;
+        var textPage300 = this.textPage300;
+        return this.tesseract.findWordsAsync().then(function(words){
+            words.should.have.length.above(100);
+            writeImageBoxes('textpage300-words-async.png', textPage300, words);
+        });
+    })
+    it('should #findTextAsync(\'plain\', true)', function(){
+        this.tesseract.image = this.textPage300;
+        return this.tesseract.findTextAsync('plain', true).then(function(result){
+            compareTextParagraph(result.text);
+            result.confidence.should.be.above(85);
+        });
+    })
+    it('should be locked while recognizing asynchronously', function(){
+        this.tesseract.image = this.textPage300;
+        var tesseract = this.tesseract;
+        var pending = tesseract.findTextLinesAsync();
+        (function(){ tesseract.findWords(); }).should.throw(Error, /busy/);
+        (function(){ tesseract.image = null; }).should.throw(Error, /busy/);
+        return pending.then(function(lines){
+            lines.should.have.length.above(10);
+        });
+    })
+    it('should report progress and time out', function(){
+        this.tesseract.image = this.textPage300;
+        var tesseract = this.tesseract;
+        var reported = [];
+        return tesseract.findWordsAsync({progress: function(percent){
+            reported.push(percent);
+        }}).then(function(words){
+            reported.should.have.length.above(0);
+            reported[reported.length - 1].should.be.within(1, 100);
+            // Discard the cached page, so that recognition runs again.
+            tesseract.image = tesseract.image;
+            return tesseract.findWordsAsync({timeout: 1});
+        }).then(function(){
+            throw new Error('expected rejection');
+        }, function(err){
+            err.code.should.equal('ETIMEDOUT');
+        });
+    })
+    it('should reuse a #recognize()d page for all levels', function(){
+        this.tesseract.image = this.textPage300;
+        var tesseract = this.tesseract;
+        var words = tesseract.recognize().findWords();
+        var results = tesseract.results({levels: ['region', 'textline', 'word']});
+        results.region.should.have.length.above(0);
+        results.textline.should.have.length.above(10);
+        results.word.should.have.length(words.length);
+        results.word[0].text.should.equal(words[0].text);
+        return tesseract.resultsAsync({levels: ['symbol']}).then(function(results){
+            should.exist(results.symbol[0].choices);
+        });
+    })
+    it('should return columnar #results()', function(){
+        this.tesseract.image = this.textPage300;
+        var words = this.tesseract.findWords();
+        var results = this.tesseract.results({levels: ['textline', 'word'], format: 'columnar'});
+        var columns = results.word;
+        columns.count.should.equal(words.length);
+        columns.boxes.should.be.an.instanceof(Int32Array);
+        columns.boxes.should.have.length(words.length * 4);
+        columns.boxes[2].should.equal(words[0].box.width);
+        columns.confidences.should.be.an.instanceof(Float32Array);
+        columns.text.toString('utf8', columns.textOffsets[0], columns.textOffsets[1])
+            .should.equal(words[0].text);
+        columns.parents.should.have.length(words.length);
+        columns.parents[0].should.equal(0);
+        columns.parents[words.length - 1].should.equal(results.textline.count - 1);
+        should.not.exist(results.textline.parents);
+    })
+    it('should #recognizeRegions() and keep the image', function(){
+        this.tesseract.image = this.textPage300;
+        var tesseract = this.tesseract;
+        return tesseract.recognizeRegions([
+            {box: {x: 0, y: 0, width: 2000, height: 400}, pageSegMode: 'single_block'},
+            {box: {x: 0, y: 400, width: 2000, height: 400}, whitelist: 'abcdefghijklmnopqrstuvwxyz'}
+        ]).then(function(results){
+            results.should.have.length(2);
+            results[0].text.should.have.length.above(0);
+            results[1].confidence.should.be.within(0, 100);
+            tesseract.tessedit_char_whitelist.should.equal('');
+            tesseract.findTextLines().should.have.length.above(10);
+        });
+    })
+    it('should #cancel() a running job', function(){
+        this.tesseract.image = this.textPage300;
+        var pending = this.tesseract.findTextAsync('plain');
+        this.tesseract.cancel().should.equal(true);
+        return pending.then(function(){
+            throw new Error('expected rejection');
+        }, function(err){
+            err.code.should.equal('ECANCELED');
+        });
+    })
+    it('should #iterate() words in chunks', function(){
+        this.tesseract.image = this.textPage300;
+        var tesseract = this.tesseract;
+        var expected = tesseract.findWords();
+        var iterator = tesseract.iterate('word', {chunkSize: 50});
+        var words = [];
+        var loop = function() {
+            return iterator.next().then(function(item) {
+                if (item.done) {
+                    return words;
+                }
+                words.push(item.value);
+                return loop();
+            });
+        };
+        return loop().then(function(words){
+            words.should.have.length(expected.length);
+            words[0].text.should.equal(expected[0].text);
+            tesseract.findTextLines().should.have.length.above(10);
+        });
+    })
+    it('should unlock when an #iterate() is returned early', function(){
+        this.tesseract.image = this.textPage300;
+        var tesseract = this.tesseract;
+        var iterator = tesseract.iterate('symbol');
+        return iterator.next().then(function(item){
+            item.done.should.equal(false);
+            should.exist(item.value.choices);
+            return iterator.return();
+        }).then(function(item){
+            item.done.should.equal(true);
+            tesseract.findTextLines().should.have.length.above(10);
+        });
+    })
     it('should generate hOCR without recognition', function(){
         this.tesseract.image = this.textPage300;
         this.tesseract.tessedit_make_boxes_from_boxes = true;
@@ -0,0 +1,92 @@
+global.should = require('chai').should();
+var dv = require('../lib/dv');
+var fs = require('fs');
+
+describe('TesseractPool', function(){
+    this.timeout(30000);
+    this.slow(1000);
+    before(function(){
+        this.textPage300 = new dv.Image("png", fs.readFileSync(__dirname + '/fixtures/textpage300.png'));
+        this.pool = new dv.TesseractPool('eng', 2);
+    })
+    it('should have #size engines', function(){
+        this.pool.size.should.equal(2);
+        this.pool.idle.should.equal(2);
+        this.pool.pending.should.equal(0);
+    })
+    it('should #recognize() words', function(){
+        return this.pool.recognize(this.textPage300).then(function(words){
+            words.should.have.length.above(100);
+            should.exist(words[0].text);
+        });
+    })
+    it('should #recognize() with options', function(){
+        return this.pool.recognize(this.textPage300, {
+            level: 'textline',
+            rectangle: {x: 0, y: 0, width: 1000, height: 500},
+            pageSegMode: 'single_block'
+        }).then(function(lines){
+            lines.should.have.length.above(0);
+        });
+    })
+    it('should queue jobs beyond #size', function(){
+        var pool = this.pool;
+        var jobs = [];
+        for (var i = 0; i < 4; i++) {
+            jobs.push(pool.recognize(this.textPage300, {level: 'region', recognize: false}));
+        }
+        pool.idle.should.equal(0);
+        pool.pending.should.equal(2);
+        return Promise.all(jobs).then(function(results){
+            results.should.have.length(4);
+            pool.idle.should.equal(2);
+            pool.pending.should.equal(0);
+        });
+    })
+    it('should cancel jobs through an AbortSignal', function(){
+        if (typeof AbortController === 'undefined') {
+            return this.skip();
+        }
+        var pool = this.pool;
+        var controller = new AbortController();
+        var jobs = [];
+        for (var i = 0; i < 3; i++) {
+            jobs.push(pool.recognize(this.textPage300, {signal: controller.signal}));
+        }
+        pool.pending.should.equal(1);
+        controller.abort();
+        pool.pending.should.equal(0);
+        return Promise.all(jobs.map(function(job){
+            return job.then(function(){
+                throw new Error('expected rejection');
+            }, function(err){
+                err.code.should.equal('ECANCELED');
+            });
+        }));
+    })
+    it('should #recognizeRegions() across engines', function(){
+        var regions = [];
+        for (var i = 0; i < 6; i++) {
+            regions.push({box: {x: 0, y: i * 200, width: 2000, height: 200},
+                          pageSegMode: 'single_block'});
+        }
+        regions.push({box: {x: 5000, y: 5000, width: 10, height: 10}});
+        var pool = this.pool;
+        return pool.recognizeRegions(this.textPage300, regions, {level: 'word'}).then(function(results){
+            results.should.have.length(regions.length);
+            results[0].text.should.have.length.above(0);
+            results[0].results.should.be.an.instanceof(Array);
+            results[regions.length - 1].text.should.equal('');
+            pool.idle.should.equal(2);
+        });
+    })
+    it('should reject invalid levels', function(){
+        var pool = this.pool;
+        var image = this.textPage300;
+        return pool.recognize(image, {level: 'page'}).then(function(){
+            throw new Error('expected rejection');
+        }, function(err){
+            err.should.be.an.instanceof(TypeError);
+        });
+    })
+})
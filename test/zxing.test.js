@@ -70,4 +70,22 @@ describe('ZXing', function(){
             should.exist(code.points);
         })
     })
+    describe('#findCodeAsync()', function(){
+        it('should find nothing', function(){
+            this.zxing.image = this.textpage300;
+            return this.zxing.findCodeAsync().then(function(code){
+                should.not.exist(code);
+            });
+        })
+        it('should find codes concurrently', function(){
+            var zxing1 = new dv.ZXing(this.barcode1);
+            var zxing3 = new dv.ZXing(this.barcode3);
+            return Promise.all([zxing1.findCodeAsync(), zxing3.findCodeAsync()]).then(function(codes){
+                codes[0].type.should.equal('ITF');
+                codes[0].data.should.equal('1234567890');
+                codes[1].type.should.equal('PDF_417');
+                should.exist(codes[1].points);
+            });
+        })
+    })
 })